@@ -0,0 +1,114 @@
+#ifndef BIT_MATRIX_H
+#define BIT_MATRIX_H
+
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <utility>
+
+#define BIT_MATRIX_ALIGNMENT 64
+#define BIT_MATRIX_HUGE_PAGE_SIZE (2u << 20)
+
+// A matrix of bits, stored as a single contiguous block in row-major order.
+// Each row is padded to a whole number of 64-byte cache lines and the block is
+// 64-byte aligned, so that every row starts on a cache line.  Blocks of at
+// least 2MB are aligned to 2MB and marked as candidates for transparent huge
+// pages.
+//
+// m[i] is a pointer to the first word of row i.
+class BitMatrix
+{
+    int num_rows;
+    int row_stride;    // words per row, including padding
+    size_t num_bytes;
+    unsigned long long * words;
+
+    auto allocate() -> void
+    {
+        num_bytes = size_t(num_rows) * row_stride * sizeof(unsigned long long);
+        words = nullptr;
+        if (num_bytes == 0)
+            return;
+        size_t alignment = num_bytes >= BIT_MATRIX_HUGE_PAGE_SIZE ? BIT_MATRIX_HUGE_PAGE_SIZE : BIT_MATRIX_ALIGNMENT;
+        void * p;
+        if (posix_memalign(&p, alignment, num_bytes) != 0)
+            fail("Failed to allocate a bit matrix.");
+#ifdef MADV_HUGEPAGE
+        if (alignment == BIT_MATRIX_HUGE_PAGE_SIZE)
+            madvise(p, num_bytes, MADV_HUGEPAGE);
+#endif
+        words = static_cast<unsigned long long *>(p);
+    }
+
+public:
+    BitMatrix() : num_rows(0), row_stride(0), num_bytes(0), words(nullptr) {}
+
+    // All bits are initially zero
+    BitMatrix(int num_rows, int num_words)
+            : num_rows(num_rows),
+              row_stride((num_words + BIT_MATRIX_ALIGNMENT / 8 - 1) / (BIT_MATRIX_ALIGNMENT / 8) *
+                      (BIT_MATRIX_ALIGNMENT / 8))
+    {
+        allocate();
+        clear();
+    }
+
+    BitMatrix(const BitMatrix & other) : num_rows(other.num_rows), row_stride(other.row_stride)
+    {
+        allocate();
+        if (num_bytes)
+            memcpy(words, other.words, num_bytes);
+    }
+
+    BitMatrix(BitMatrix && other) : BitMatrix()
+    {
+        swap(other);
+    }
+
+    auto operator=(BitMatrix other) -> BitMatrix &
+    {
+        swap(other);
+        return *this;
+    }
+
+    ~BitMatrix()
+    {
+        free(words);
+    }
+
+    auto swap(BitMatrix & other) -> void
+    {
+        std::swap(num_rows, other.num_rows);
+        std::swap(row_stride, other.row_stride);
+        std::swap(num_bytes, other.num_bytes);
+        std::swap(words, other.words);
+    }
+
+    auto operator[](int row) -> unsigned long long *
+    {
+        return words + size_t(row) * row_stride;
+    }
+
+    auto operator[](int row) const -> const unsigned long long *
+    {
+        return words + size_t(row) * row_stride;
+    }
+
+    // Set all bits to zero
+    auto clear() -> void
+    {
+        if (num_bytes)
+            memset(words, 0, num_bytes);
+    }
+
+    // All bits are zero after resizing
+    auto resize(int new_num_rows, int new_num_words) -> void
+    {
+        BitMatrix(new_num_rows, new_num_words).swap(*this);
+    }
+};
+
+#endif
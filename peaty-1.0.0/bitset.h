@@ -1,8 +1,27 @@
 #ifndef BITSET_H
 #define BITSET_H
 
+#include "bitset_kernels.h"
 #include "graph.h"
 
+#include <type_traits>
+
+// A read-only bitset: either a vector or a row of a BitMatrix
+struct ConstBitsetRef
+{
+    const unsigned long long * words;
+
+    ConstBitsetRef(const vector<unsigned long long> & bitset) : words(bitset.data()) {}
+    ConstBitsetRef(const unsigned long long * words) : words(words) {}
+
+    auto operator[](int i) const -> const unsigned long long & { return words[i]; }
+    auto data() const -> const unsigned long long * { return words; }
+};
+
+// Bitsets of at least this many words are processed by the SIMD kernels in
+// bitset_kernels.cpp; shorter ones use the inline loops below
+#define BITSET_KERNEL_MIN_WORDS 16
+
 static void set_first_n_bits(vector<unsigned long long> & bitset, int n)
 {
     int i = 0;
@@ -15,7 +34,7 @@ static void set_first_n_bits(vector<unsigned long long> & bitset, int n)
         bitset[i] = (1ull << n) - 1;
 }
 
-static bool test_bit(const vector<unsigned long long> & bitset, int bit)
+static bool test_bit(ConstBitsetRef bitset, int bit)
 {
     return 0 != (bitset[bit/BITS_PER_WORD] & (1ull << (bit%BITS_PER_WORD)));
 }
@@ -35,41 +54,63 @@ static void unset_bit_if(vector<unsigned long long> & bitset, int bit, bool cond
     bitset[bit/BITS_PER_WORD] &= ~((unsigned long long) condition << (bit%BITS_PER_WORD));
 }
 
-static int bitset_popcount(const vector<unsigned long long> & bitset, int num_words)
+static int bitset_popcount(ConstBitsetRef bitset, int num_words)
 {
+    if (num_words >= BITSET_KERNEL_MIN_WORDS)
+        return bitset_kernels->popcount(bitset.data(), num_words);
     int count = 0;
     for (int i=0; i<num_words; i++)
         count += __builtin_popcountll(bitset[i]);
     return count;
 }
 
-static int bitset_intersection_popcount(const vector<unsigned long long> & bitset1,
-        const vector<unsigned long long> & bitset2, int num_words)
+static int bitset_intersection_popcount(ConstBitsetRef bitset1,
+        ConstBitsetRef bitset2, int num_words)
 {
+    if (num_words >= BITSET_KERNEL_MIN_WORDS)
+        return bitset_kernels->intersection_popcount(bitset1.data(), bitset2.data(), num_words);
     int count = 0;
     for (int i=0; i<num_words; i++)
         count += __builtin_popcountll(bitset1[i] & bitset2[i]);
     return count;
 }
 
-static bool bitset_empty(const vector<unsigned long long> & bitset, int num_words)
+static bool bitset_empty(ConstBitsetRef bitset, int num_words)
 {
+    if (num_words >= BITSET_KERNEL_MIN_WORDS)
+        return bitset_kernels->first_nonzero_word(bitset.data(), num_words) == -1;
     for (int i=0; i<num_words; i++)
         if (bitset[i] != 0)
             return false;
     return true;
 }
 
-static int first_set_bit(const vector<unsigned long long> & bitset,
-                         int num_words)
+// The first set bit in words first_word to num_words-1.  When the set bits are
+// removed one at a time in increasing order, the caller can pass the word of
+// the previous bit as first_word, rather than rescanning from word 0.
+static int first_set_bit(ConstBitsetRef bitset,
+                         int first_word, int num_words)
 {
-    for (int i=0; i<num_words; i++)
+    if (num_words - first_word >= BITSET_KERNEL_MIN_WORDS) {
+        int i = bitset_kernels->first_nonzero_word(bitset.data() + first_word, num_words - first_word);
+        if (i == -1)
+            return -1;
+        i += first_word;
+        return i*BITS_PER_WORD + __builtin_ctzll(bitset[i]);
+    }
+    for (int i=first_word; i<num_words; i++)
         if (bitset[i] != 0)
             return i*BITS_PER_WORD + __builtin_ctzll(bitset[i]);
     return -1;
 }
 
-static int last_set_bit(const vector<unsigned long long> & bitset,
+static int first_set_bit(ConstBitsetRef bitset,
+                         int num_words)
+{
+    return first_set_bit(bitset, 0, num_words);
+}
+
+static int last_set_bit(ConstBitsetRef bitset,
                          int num_words)
 {
     for (int i=num_words; i--; )
@@ -78,28 +119,38 @@ static int last_set_bit(const vector<unsigned long long> & bitset,
     return -1;
 }
 
-static bool have_non_empty_intersection(const vector<unsigned long long> & bitset1,
-                                     const vector<unsigned long long> & bitset2,
+static bool have_non_empty_intersection(ConstBitsetRef bitset1,
+                                     ConstBitsetRef bitset2,
                                      int num_words)
 {
+    if (num_words >= BITSET_KERNEL_MIN_WORDS)
+        return bitset_kernels->have_non_empty_intersection(bitset1.data(), bitset2.data(), num_words);
     for (int i=0; i<num_words; i++)
         if (bitset1[i] & bitset2[i])
             return true;
     return false;
 }
 
-static bool have_empty_intersection(const vector<unsigned long long> & bitset1,
-                                     const vector<unsigned long long> & bitset2,
+static bool have_empty_intersection(ConstBitsetRef bitset1,
+                                     ConstBitsetRef bitset2,
+                                     int num_words)
+{
+    return !have_non_empty_intersection(bitset1, bitset2, num_words);
+}
+
+// Is every bit of bitset1 also set in bitset2?
+static bool bitset_is_subset(ConstBitsetRef bitset1,
+                                     ConstBitsetRef bitset2,
                                      int num_words)
 {
     for (int i=0; i<num_words; i++)
-        if (bitset1[i] & bitset2[i])
+        if (bitset1[i] & ~bitset2[i])
             return false;
     return true;
 }
 
-static int first_nonzero_in_intersection(const vector<unsigned long long> & bitset1,
-                                     const vector<unsigned long long> & bitset2,
+static int first_nonzero_in_intersection(ConstBitsetRef bitset1,
+                                     ConstBitsetRef bitset2,
                                      int num_words)
 {
     for (int i=0; i<num_words; i++) {
@@ -110,41 +161,76 @@ static int first_nonzero_in_intersection(const vector<unsigned long long> & bits
     return -1;
 }
 
-static void bitset_intersection(const vector<unsigned long long> & src1,
-                                     const vector<unsigned long long> & src2,
+// Only words first_word to num_words-1 of dst are written
+static void bitset_intersection(ConstBitsetRef src1,
+                                     ConstBitsetRef src2,
                                      vector<unsigned long long> & dst,
-                                     int num_words)
+                                     int first_word, int num_words)
 {
-    for (int i=0; i<num_words; i++)
+    if (num_words - first_word >= BITSET_KERNEL_MIN_WORDS) {
+        bitset_kernels->intersection(src1.data() + first_word, src2.data() + first_word,
+                dst.data() + first_word, num_words - first_word);
+        return;
+    }
+    for (int i=first_word; i<num_words; i++)
         dst[i] = src1[i] & src2[i];
 }
 
-static void bitset_intersect_with(vector<unsigned long long> & bitset1,
-                                     const vector<unsigned long long> & bitset2,
+static void bitset_intersection(ConstBitsetRef src1,
+                                     ConstBitsetRef src2,
+                                     vector<unsigned long long> & dst,
                                      int num_words)
 {
-    for (int i=0; i<num_words; i++)
+    bitset_intersection(src1, src2, dst, 0, num_words);
+}
+
+// Only words first_word to num_words-1 of bitset1 are modified
+static void bitset_intersect_with(vector<unsigned long long> & bitset1,
+                                     ConstBitsetRef bitset2,
+                                     int first_word, int num_words)
+{
+    if (num_words - first_word >= BITSET_KERNEL_MIN_WORDS) {
+        bitset_kernels->intersect_with(bitset1.data() + first_word, bitset2.data() + first_word,
+                num_words - first_word);
+        return;
+    }
+    for (int i=first_word; i<num_words; i++)
         bitset1[i] &= bitset2[i];
 }
 
+static void bitset_intersect_with(vector<unsigned long long> & bitset1,
+                                     ConstBitsetRef bitset2,
+                                     int num_words)
+{
+    bitset_intersect_with(bitset1, bitset2, 0, num_words);
+}
+
 static void bitset_intersect_with_complement(vector<unsigned long long> & bitset,
-                                     const vector<unsigned long long> & bitset2,
+                                     ConstBitsetRef bitset2,
                                      int num_words)
 {
+    if (num_words >= BITSET_KERNEL_MIN_WORDS) {
+        bitset_kernels->intersect_with_complement(bitset.data(), bitset2.data(), num_words);
+        return;
+    }
     for (int i=0; i<num_words; i++)
         bitset[i] &= ~bitset2[i];
 }
 
-static void bitset_intersection_with_complement(const vector<unsigned long long> & src1,
-                                     const vector<unsigned long long> & src2,
+static void bitset_intersection_with_complement(ConstBitsetRef src1,
+                                     ConstBitsetRef src2,
                                      vector<unsigned long long> & dst,
                                      int num_words)
 {
+    if (num_words >= BITSET_KERNEL_MIN_WORDS) {
+        bitset_kernels->intersection_with_complement(src1.data(), src2.data(), dst.data(), num_words);
+        return;
+    }
     for (int i=0; i<num_words; i++)
         dst[i] = src1[i] & ~src2[i];
 }
 
-static void copy_bitset(const vector<unsigned long long> & src,
+static void copy_bitset(ConstBitsetRef src,
                         vector<unsigned long long> & dest,
                         int num_words)
 {
@@ -159,7 +245,7 @@ static void clear_bitset(vector<unsigned long long> & bitset,
         bitset[i] = 0ull;
 }
 
-static int calc_numwords(const vector<unsigned long long> & bitset, int graph_num_words)
+static int calc_numwords(ConstBitsetRef bitset, int graph_num_words)
 {
     for (int i=graph_num_words; i--; )
         if (bitset[i] != 0)
@@ -168,9 +254,9 @@ static int calc_numwords(const vector<unsigned long long> & bitset, int graph_nu
 }
 
 template<typename F>
-static void bitset_foreach(const vector<unsigned long long> & bitset, F f, int numwords)
+static void bitset_foreach(ConstBitsetRef bitset, F f, int first_word, int numwords)
 {
-        for (int i=0; i<numwords; i++) {
+        for (int i=first_word; i<numwords; i++) {
             unsigned long long word = bitset[i];
             while (word) {
                 int bit = __builtin_ctzll(word);
@@ -181,4 +267,35 @@ static void bitset_foreach(const vector<unsigned long long> & bitset, F f, int n
         }
 }
 
+template<typename F>
+static void bitset_foreach(ConstBitsetRef bitset, F f, int numwords)
+{
+    bitset_foreach(bitset, f, 0, numwords);
+}
+
+// Bitsets of up to this many words have search kernels specialised for their
+// exact length
+#define MAX_FIXED_NUM_WORDS 8
+
+// Call f(std::integral_constant<int, num_words>()) if num_words is between 1
+// and MAX_FIXED_NUM_WORDS, and f(std::integral_constant<int, 0>()) otherwise.
+// A kernel that takes its word count from the constant, falling back to
+// num_words if the constant is 0, gets the loops of the functions above
+// unrolled for short bitsets.
+template<typename F>
+static auto dispatch_on_num_words(int num_words, F f) -> decltype(f(std::integral_constant<int, 0>()))
+{
+    switch (num_words) {
+    case 1: return f(std::integral_constant<int, 1>());
+    case 2: return f(std::integral_constant<int, 2>());
+    case 3: return f(std::integral_constant<int, 3>());
+    case 4: return f(std::integral_constant<int, 4>());
+    case 5: return f(std::integral_constant<int, 5>());
+    case 6: return f(std::integral_constant<int, 6>());
+    case 7: return f(std::integral_constant<int, 7>());
+    case 8: return f(std::integral_constant<int, 8>());
+    default: return f(std::integral_constant<int, 0>());
+    }
+}
+
 #endif
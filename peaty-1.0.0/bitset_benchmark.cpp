@@ -0,0 +1,143 @@
+// Microbenchmark for the bitset kernels in bitset_kernels.cpp.
+//
+// For each bitset length, times each operation with every kernel table that
+// the CPU supports, and also times extracting the set bits of a sparse bitset
+// in increasing order with and without tracking the first non-zero word.
+//
+// Build with `cmake --build <dir> --target bitset_benchmark`.
+
+#include "bitset.h"
+#include "bitset_kernels.h"
+
+#include <stdio.h>
+
+#include <chrono>
+#include <functional>
+#include <random>
+#include <vector>
+
+using std::vector;
+
+// Stops the compiler from discarding the results of the benchmarked calls
+static volatile long sink;
+
+// Nanoseconds per call of f, averaged over enough calls to process about
+// 2^28 words
+static double time_per_call(int num_words, const std::function<long()> & f)
+{
+    long num_calls = (1l << 28) / num_words;
+    auto start = std::chrono::steady_clock::now();
+    long total = 0;
+    for (long i=0; i<num_calls; i++)
+        total += f();
+    auto stop = std::chrono::steady_clock::now();
+    sink = total;
+    return std::chrono::duration<double, std::nano>(stop - start).count() / num_calls;
+}
+
+static auto random_bitset(int num_words, std::mt19937_64 & rng) -> vector<unsigned long long>
+{
+    vector<unsigned long long> bitset(num_words);
+    for (auto & word : bitset)
+        word = rng();
+    return bitset;
+}
+
+static void benchmark_kernels(int n)
+{
+    int num_words = (n + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    std::mt19937_64 rng(n);
+    auto a = random_bitset(num_words, rng);
+    auto b = random_bitset(num_words, rng);
+    vector<unsigned long long> dst(num_words);
+    vector<unsigned long long> complement_of_a(num_words);
+    for (int i=0; i<num_words; i++)
+        complement_of_a[i] = ~a[i];
+
+    // only the last bit is set, so that first_nonzero_word must scan every word
+    vector<unsigned long long> last_bit_only(num_words);
+    last_bit_only[num_words - 1] = 1ull << 63;
+
+    struct Op { const char * name; std::function<long(const BitsetKernels &)> f; };
+    vector<Op> ops = {
+        {"intersection", [&](const BitsetKernels & k) {
+                k.intersection(a.data(), b.data(), dst.data(), num_words); return long(dst[0]); }},
+        {"intersection_with_complement", [&](const BitsetKernels & k) {
+                k.intersection_with_complement(a.data(), b.data(), dst.data(), num_words); return long(dst[0]); }},
+        {"intersect_with", [&](const BitsetKernels & k) {
+                k.intersect_with(dst.data(), b.data(), num_words); return long(dst[0]); }},
+        {"popcount", [&](const BitsetKernels & k) {
+                return long(k.popcount(a.data(), num_words)); }},
+        {"intersection_popcount", [&](const BitsetKernels & k) {
+                return long(k.intersection_popcount(a.data(), b.data(), num_words)); }},
+        {"have_non_empty_intersection", [&](const BitsetKernels & k) {
+                return long(k.have_non_empty_intersection(a.data(), complement_of_a.data(), num_words)); }},
+        {"first_nonzero_word", [&](const BitsetKernels & k) {
+                return long(k.first_nonzero_word(last_bit_only.data(), num_words)); }},
+    };
+
+    auto kernels = supported_bitset_kernels();
+    printf("n = %d (%d words)\n", n, num_words);
+    printf("  %-30s", "operation");
+    for (auto k : kernels)
+        printf(" %12s", k->name);
+    printf("   (ns per call; speedup over scalar)\n");
+    for (auto & op : ops) {
+        printf("  %-30s", op.name);
+        double scalar_time = 0;
+        for (auto k : kernels) {
+            double t = time_per_call(num_words, [&]() { return op.f(*k); });
+            if (k == kernels[0])
+                scalar_time = t;
+            printf(" %7.1f %3.1fx", t, scalar_time / t);
+        }
+        printf("\n");
+    }
+}
+
+// Remove the set bits of a bitset with one bit in every eight words, lowest
+// first, as the colourers do
+static void benchmark_scans(int n)
+{
+    int num_words = (n + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    vector<unsigned long long> original(num_words);
+    for (int i=0; i<n; i+=8*BITS_PER_WORD)
+        set_bit(original, i);
+    vector<unsigned long long> bitset(num_words);
+
+    double from_start = time_per_call(num_words, [&]() {
+        copy_bitset(original, bitset, num_words);
+        long total = 0;
+        int v;
+        while ((v=first_set_bit(bitset, num_words))!=-1) {
+            unset_bit(bitset, v);
+            total += v;
+        }
+        return total;
+    });
+
+    double tracked = time_per_call(num_words, [&]() {
+        copy_bitset(original, bitset, num_words);
+        long total = 0;
+        int v;
+        int first_word = 0;
+        while ((v=first_set_bit(bitset, first_word, num_words))!=-1) {
+            first_word = v / BITS_PER_WORD;
+            unset_bit(bitset, v);
+            total += v;
+        }
+        return total;
+    });
+
+    printf("  %-30s %.1f ns rescanning from word 0, %.1f ns tracking the first word (%.1fx)\n",
+            "extract all set bits", from_start, tracked, from_start / tracked);
+}
+
+int main()
+{
+    printf("active kernels: %s\n", bitset_kernels->name);
+    for (int n : {1000, 10000, 50000}) {
+        benchmark_kernels(n);
+        benchmark_scans(n);
+    }
+}
@@ -0,0 +1,342 @@
+#include "bitset_kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_BITSET_KERNELS
+#include <immintrin.h>
+#endif
+
+/*******************************************************************************
+                                 Scalar kernels
+*******************************************************************************/
+
+static void scalar_intersection(const unsigned long long * src1, const unsigned long long * src2,
+        unsigned long long * dst, int num_words)
+{
+    for (int i=0; i<num_words; i++)
+        dst[i] = src1[i] & src2[i];
+}
+
+static void scalar_intersection_with_complement(const unsigned long long * src1,
+        const unsigned long long * src2, unsigned long long * dst, int num_words)
+{
+    for (int i=0; i<num_words; i++)
+        dst[i] = src1[i] & ~src2[i];
+}
+
+static void scalar_intersect_with(unsigned long long * bitset1, const unsigned long long * bitset2,
+        int num_words)
+{
+    for (int i=0; i<num_words; i++)
+        bitset1[i] &= bitset2[i];
+}
+
+static void scalar_intersect_with_complement(unsigned long long * bitset1,
+        const unsigned long long * bitset2, int num_words)
+{
+    for (int i=0; i<num_words; i++)
+        bitset1[i] &= ~bitset2[i];
+}
+
+static int scalar_popcount(const unsigned long long * bitset, int num_words)
+{
+    int count = 0;
+    for (int i=0; i<num_words; i++)
+        count += __builtin_popcountll(bitset[i]);
+    return count;
+}
+
+static int scalar_intersection_popcount(const unsigned long long * bitset1,
+        const unsigned long long * bitset2, int num_words)
+{
+    int count = 0;
+    for (int i=0; i<num_words; i++)
+        count += __builtin_popcountll(bitset1[i] & bitset2[i]);
+    return count;
+}
+
+static bool scalar_have_non_empty_intersection(const unsigned long long * bitset1,
+        const unsigned long long * bitset2, int num_words)
+{
+    for (int i=0; i<num_words; i++)
+        if (bitset1[i] & bitset2[i])
+            return true;
+    return false;
+}
+
+static int scalar_first_nonzero_word(const unsigned long long * bitset, int num_words)
+{
+    for (int i=0; i<num_words; i++)
+        if (bitset[i] != 0)
+            return i;
+    return -1;
+}
+
+static const BitsetKernels scalar_bitset_kernels = {
+    "scalar",
+    scalar_intersection,
+    scalar_intersection_with_complement,
+    scalar_intersect_with,
+    scalar_intersect_with_complement,
+    scalar_popcount,
+    scalar_intersection_popcount,
+    scalar_have_non_empty_intersection,
+    scalar_first_nonzero_word
+};
+
+#ifdef HAVE_X86_BITSET_KERNELS
+
+/*******************************************************************************
+                                  AVX2 kernels
+*******************************************************************************/
+
+#define AVX2_TARGET __attribute__((target("avx2,popcnt")))
+
+AVX2_TARGET
+static void avx2_intersection(const unsigned long long * src1, const unsigned long long * src2,
+        unsigned long long * dst, int num_words)
+{
+    int i = 0;
+    for ( ; i+4<=num_words; i+=4) {
+        __m256i a = _mm256_loadu_si256((const __m256i *) (src1 + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *) (src2 + i));
+        _mm256_storeu_si256((__m256i *) (dst + i), _mm256_and_si256(a, b));
+    }
+    for ( ; i<num_words; i++)
+        dst[i] = src1[i] & src2[i];
+}
+
+AVX2_TARGET
+static void avx2_intersection_with_complement(const unsigned long long * src1,
+        const unsigned long long * src2, unsigned long long * dst, int num_words)
+{
+    int i = 0;
+    for ( ; i+4<=num_words; i+=4) {
+        __m256i a = _mm256_loadu_si256((const __m256i *) (src1 + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *) (src2 + i));
+        _mm256_storeu_si256((__m256i *) (dst + i), _mm256_andnot_si256(b, a));
+    }
+    for ( ; i<num_words; i++)
+        dst[i] = src1[i] & ~src2[i];
+}
+
+AVX2_TARGET
+static void avx2_intersect_with(unsigned long long * bitset1, const unsigned long long * bitset2,
+        int num_words)
+{
+    avx2_intersection(bitset1, bitset2, bitset1, num_words);
+}
+
+AVX2_TARGET
+static void avx2_intersect_with_complement(unsigned long long * bitset1,
+        const unsigned long long * bitset2, int num_words)
+{
+    avx2_intersection_with_complement(bitset1, bitset2, bitset1, num_words);
+}
+
+// The number of set bits in each byte of v, found by looking up each nibble
+// in a 16-entry table (Mula's method)
+AVX2_TARGET
+static __m256i avx2_byte_popcounts(__m256i v)
+{
+    const __m256i lookup = _mm256_setr_epi8(
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_nibbles = _mm256_set1_epi8(0x0f);
+    __m256i lo = _mm256_and_si256(v, low_nibbles);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibbles);
+    return _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+}
+
+AVX2_TARGET
+static int avx2_sum_of_lanes(__m256i v)
+{
+    return _mm256_extract_epi64(v, 0) + _mm256_extract_epi64(v, 1) +
+            _mm256_extract_epi64(v, 2) + _mm256_extract_epi64(v, 3);
+}
+
+AVX2_TARGET
+static int avx2_popcount(const unsigned long long * bitset, int num_words)
+{
+    __m256i counts = _mm256_setzero_si256();
+    int i = 0;
+    for ( ; i+4<=num_words; i+=4) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (bitset + i));
+        counts = _mm256_add_epi64(counts, _mm256_sad_epu8(avx2_byte_popcounts(v), _mm256_setzero_si256()));
+    }
+    int count = avx2_sum_of_lanes(counts);
+    for ( ; i<num_words; i++)
+        count += __builtin_popcountll(bitset[i]);
+    return count;
+}
+
+AVX2_TARGET
+static int avx2_intersection_popcount(const unsigned long long * bitset1,
+        const unsigned long long * bitset2, int num_words)
+{
+    __m256i counts = _mm256_setzero_si256();
+    int i = 0;
+    for ( ; i+4<=num_words; i+=4) {
+        __m256i a = _mm256_loadu_si256((const __m256i *) (bitset1 + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *) (bitset2 + i));
+        __m256i v = _mm256_and_si256(a, b);
+        counts = _mm256_add_epi64(counts, _mm256_sad_epu8(avx2_byte_popcounts(v), _mm256_setzero_si256()));
+    }
+    int count = avx2_sum_of_lanes(counts);
+    for ( ; i<num_words; i++)
+        count += __builtin_popcountll(bitset1[i] & bitset2[i]);
+    return count;
+}
+
+AVX2_TARGET
+static bool avx2_have_non_empty_intersection(const unsigned long long * bitset1,
+        const unsigned long long * bitset2, int num_words)
+{
+    int i = 0;
+    for ( ; i+4<=num_words; i+=4) {
+        __m256i a = _mm256_loadu_si256((const __m256i *) (bitset1 + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *) (bitset2 + i));
+        if (!_mm256_testz_si256(a, b))
+            return true;
+    }
+    for ( ; i<num_words; i++)
+        if (bitset1[i] & bitset2[i])
+            return true;
+    return false;
+}
+
+AVX2_TARGET
+static int avx2_first_nonzero_word(const unsigned long long * bitset, int num_words)
+{
+    int i = 0;
+    for ( ; i+4<=num_words; i+=4) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (bitset + i));
+        if (!_mm256_testz_si256(v, v))
+            break;
+    }
+    for ( ; i<num_words; i++)
+        if (bitset[i] != 0)
+            return i;
+    return -1;
+}
+
+static const BitsetKernels avx2_bitset_kernels = {
+    "avx2",
+    avx2_intersection,
+    avx2_intersection_with_complement,
+    avx2_intersect_with,
+    avx2_intersect_with_complement,
+    avx2_popcount,
+    avx2_intersection_popcount,
+    avx2_have_non_empty_intersection,
+    avx2_first_nonzero_word
+};
+
+/*******************************************************************************
+                                 AVX-512 kernels
+*******************************************************************************/
+
+// Each loop handles its last, partial vector with a masked load and store.
+// AVX-512F has no byte shuffle, so the popcount kernels are the AVX2 ones.
+
+#define AVX512_TARGET __attribute__((target("avx512f")))
+
+AVX512_TARGET
+static __mmask8 avx512_tail_mask(int num_words_left)
+{
+    return num_words_left >= 8 ? 0xff : (1u << num_words_left) - 1;
+}
+
+AVX512_TARGET
+static void avx512_intersection(const unsigned long long * src1, const unsigned long long * src2,
+        unsigned long long * dst, int num_words)
+{
+    for (int i=0; i<num_words; i+=8) {
+        __mmask8 m = avx512_tail_mask(num_words - i);
+        __m512i a = _mm512_maskz_loadu_epi64(m, src1 + i);
+        __m512i b = _mm512_maskz_loadu_epi64(m, src2 + i);
+        _mm512_mask_storeu_epi64(dst + i, m, _mm512_maskz_and_epi64(m, a, b));
+    }
+}
+
+AVX512_TARGET
+static void avx512_intersection_with_complement(const unsigned long long * src1,
+        const unsigned long long * src2, unsigned long long * dst, int num_words)
+{
+    for (int i=0; i<num_words; i+=8) {
+        __mmask8 m = avx512_tail_mask(num_words - i);
+        __m512i a = _mm512_maskz_loadu_epi64(m, src1 + i);
+        __m512i b = _mm512_maskz_loadu_epi64(m, src2 + i);
+        _mm512_mask_storeu_epi64(dst + i, m, _mm512_maskz_andnot_epi64(m, b, a));
+    }
+}
+
+AVX512_TARGET
+static void avx512_intersect_with(unsigned long long * bitset1, const unsigned long long * bitset2,
+        int num_words)
+{
+    avx512_intersection(bitset1, bitset2, bitset1, num_words);
+}
+
+AVX512_TARGET
+static void avx512_intersect_with_complement(unsigned long long * bitset1,
+        const unsigned long long * bitset2, int num_words)
+{
+    avx512_intersection_with_complement(bitset1, bitset2, bitset1, num_words);
+}
+
+AVX512_TARGET
+static bool avx512_have_non_empty_intersection(const unsigned long long * bitset1,
+        const unsigned long long * bitset2, int num_words)
+{
+    for (int i=0; i<num_words; i+=8) {
+        __mmask8 m = avx512_tail_mask(num_words - i);
+        __m512i a = _mm512_maskz_loadu_epi64(m, bitset1 + i);
+        __m512i b = _mm512_maskz_loadu_epi64(m, bitset2 + i);
+        if (_mm512_test_epi64_mask(a, b))
+            return true;
+    }
+    return false;
+}
+
+AVX512_TARGET
+static int avx512_first_nonzero_word(const unsigned long long * bitset, int num_words)
+{
+    for (int i=0; i<num_words; i+=8) {
+        __m512i v = _mm512_maskz_loadu_epi64(avx512_tail_mask(num_words - i), bitset + i);
+        __mmask8 nonzero = _mm512_test_epi64_mask(v, v);
+        if (nonzero)
+            return i + __builtin_ctz(nonzero);
+    }
+    return -1;
+}
+
+static const BitsetKernels avx512_bitset_kernels = {
+    "avx512",
+    avx512_intersection,
+    avx512_intersection_with_complement,
+    avx512_intersect_with,
+    avx512_intersect_with_complement,
+    avx2_popcount,
+    avx2_intersection_popcount,
+    avx512_have_non_empty_intersection,
+    avx512_first_nonzero_word
+};
+
+#endif
+
+auto supported_bitset_kernels() -> vector<const BitsetKernels *>
+{
+    vector<const BitsetKernels *> result { &scalar_bitset_kernels };
+#ifdef HAVE_X86_BITSET_KERNELS
+    // this may run before the constructor that normally initialises the CPU
+    // feature flags
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+        result.push_back(&avx2_bitset_kernels);
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt") && __builtin_cpu_supports("avx512f"))
+        result.push_back(&avx512_bitset_kernels);
+#endif
+    return result;
+}
+
+const BitsetKernels * bitset_kernels = supported_bitset_kernels().back();
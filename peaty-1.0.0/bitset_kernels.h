@@ -0,0 +1,39 @@
+#ifndef BITSET_KERNELS_H
+#define BITSET_KERNELS_H
+
+#include <vector>
+
+using std::vector;
+
+// Bulk operations on arrays of 64-bit words.  There is one table of kernels
+// for each instruction set; bitset.h calls the kernels through
+// `bitset_kernels` for bitsets long enough to pay for the indirect call.
+struct BitsetKernels
+{
+    const char * name;
+
+    void (*intersection)(const unsigned long long * src1, const unsigned long long * src2,
+            unsigned long long * dst, int num_words);
+    void (*intersection_with_complement)(const unsigned long long * src1, const unsigned long long * src2,
+            unsigned long long * dst, int num_words);
+    void (*intersect_with)(unsigned long long * bitset1, const unsigned long long * bitset2, int num_words);
+    void (*intersect_with_complement)(unsigned long long * bitset1, const unsigned long long * bitset2,
+            int num_words);
+    int (*popcount)(const unsigned long long * bitset, int num_words);
+    int (*intersection_popcount)(const unsigned long long * bitset1, const unsigned long long * bitset2,
+            int num_words);
+    bool (*have_non_empty_intersection)(const unsigned long long * bitset1, const unsigned long long * bitset2,
+            int num_words);
+
+    // The index of the first non-zero word, or -1 if all words are zero
+    int (*first_nonzero_word)(const unsigned long long * bitset, int num_words);
+};
+
+// The fastest kernels that this CPU supports, chosen at startup
+extern const BitsetKernels * bitset_kernels;
+
+// All kernel tables that this CPU supports, slowest (the portable scalar
+// kernels) first
+auto supported_bitset_kernels() -> vector<const BitsetKernels *>;
+
+#endif
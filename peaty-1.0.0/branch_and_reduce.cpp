@@ -0,0 +1,456 @@
+#include "branch_and_reduce.h"
+#include "lp_reduction.h"
+#include "util.h"
+
+#include <algorithm>
+
+// Vertices of a branching vertex's neighbourhood that are not adjacent to a
+// candidate mirror must form a clique; candidates that leave more vertices
+// than this are not checked
+#define MIRROR_MAX_CLIQUE_SIZE 8
+
+// The residual graph is the subgraph of g induced by the live vertices.
+// Vertices are removed by remove(), which records them on a trail, and
+// undo() restores them in reverse order.  deg[v] is the number of live
+// neighbours of a live vertex v; for a removed vertex, it is the value it had
+// when v was removed.
+//
+// A reducing search node applies the cheap rules only to a worklist of the
+// vertices whose live neighbourhoods have shrunk since the residual graph was
+// last reduced, which are the live neighbours of the vertices that have been
+// put on the trail since then.
+class BranchAndReduce
+{
+    const SparseGraph & g;
+    int reduce_interval;
+
+    vector<bool> alive;
+    vector<int> deg;
+    vector<int> trail;
+
+    // scratch marks: mark[v] == current_mark means v is marked
+    vector<unsigned> mark;
+    unsigned current_mark;
+    vector<unsigned> mark2;
+    unsigned current_mark2;
+
+    // the LP relaxation of the residual graph restricted to the vertices
+    // being reduced, which are the ones that are not outside
+    LpRelaxation lp;
+    vector<bool> outside;
+
+    // the vertices that the cheap rules are still to be tried on
+    vector<int> worklist;
+    vector<bool> in_worklist;
+
+    GreedyCliqueCover clique_cover;
+
+    auto new_mark() -> unsigned
+    {
+        return ++current_mark;
+    }
+
+    auto new_mark2() -> unsigned
+    {
+        return ++current_mark2;
+    }
+
+    auto remove(int v) -> void
+    {
+        alive[v] = false;
+        trail.push_back(v);
+        for (int w : g.neighbours(v))
+            if (alive[w])
+                --deg[w];
+    }
+
+    // Put the vertices on the trail from position trail_size onwards outside,
+    // and add their live neighbours that are being reduced to the worklist
+    auto note_removed(size_t trail_size) -> void
+    {
+        for (size_t i=trail_size; i<trail.size(); i++) {
+            outside[trail[i]] = true;
+            for (int w : g.neighbours(trail[i])) {
+                if (alive[w] && !outside[w] && !in_worklist[w]) {
+                    in_worklist[w] = true;
+                    worklist.push_back(w);
+                }
+            }
+        }
+    }
+
+    auto undo(size_t trail_size) -> void
+    {
+        while (trail.size() > trail_size) {
+            int v = trail.back();
+            trail.pop_back();
+            for (int w : g.neighbours(v))
+                if (alive[w])
+                    ++deg[w];
+            alive[v] = true;
+        }
+    }
+
+    // If a live neighbour w of v has N[v] as a subset of N[w], put w in the cover
+    auto try_domination(int v, vector<int> & forced) -> bool
+    {
+        unsigned m = new_mark();
+        mark[v] = m;
+        for (int w : g.neighbours(v))
+            if (alive[w])
+                mark[w] = m;
+
+        for (int w : g.neighbours(v)) {
+            if (!alive[w] || deg[w] < deg[v])
+                continue;
+            int num_in_closed_neighbourhood = 0;
+            for (int x : g.neighbours(w))
+                if (alive[x] && mark[x] == m)
+                    ++num_in_closed_neighbourhood;
+            if (num_in_closed_neighbourhood == deg[v]) {
+                remove(w);
+                forced.push_back(w);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Solve the LP relaxation of the live vertices of vv, which must be the
+    // vertices that are not outside.  Vertices with value 1 are put in the cover
+    // and vertices with value 0 are removed.  Return the LP lower bound if
+    // nothing was removed, and -1 otherwise.
+    auto try_lp_reduction(const vector<int> & vv, vector<int> & forced) -> int
+    {
+        vector<int> live_vv;
+        for (int v : vv)
+            if (alive[v])
+                live_vv.push_back(v);
+        vector<int> zero_vv, one_vv;
+        int bound = lp.solve(g, live_vv, outside, zero_vv, one_vv);
+
+        if (zero_vv.empty() && one_vv.empty())
+            return bound;
+        for (int v : one_vv) {
+            remove(v);
+            forced.push_back(v);
+        }
+        for (int v : zero_vv)
+            remove(v);
+        return -1;
+    }
+
+    // Apply the degree-0, degree-1, degree-2 triangle and domination rules to
+    // a live vertex v, and return true if any vertices were removed
+    auto try_cheap_rules(int v, vector<int> & forced) -> bool
+    {
+        if (deg[v] == 0) {
+            remove(v);
+            return true;
+        } else if (deg[v] == 1) {
+            for (int w : g.neighbours(v)) {
+                if (alive[w]) {
+                    remove(w);
+                    forced.push_back(w);
+                    break;
+                }
+            }
+            remove(v);
+            return true;
+        } else if (deg[v] == 2) {
+            int nbrs[2];
+            int num_nbrs = 0;
+            for (int w : g.neighbours(v))
+                if (alive[w])
+                    nbrs[num_nbrs++] = w;
+            if (!g.has_edge(nbrs[0], nbrs[1]))
+                return false;
+            for (int w : nbrs) {
+                remove(w);
+                forced.push_back(w);
+            }
+            remove(v);
+            return true;
+        } else {
+            return try_domination(v, forced);
+        }
+    }
+
+    // Reduce the live vertices of vv.  If reduced_trail_size is -1, every
+    // vertex is tried; otherwise, the residual graph restricted to vv was
+    // reduced when the trail had that size, and only vertices near the ones
+    // removed since then are tried.  The cheap rules are applied until none
+    // applies, and then the LP reduction, repeating until nothing changes.
+    // The vertices that are put in the cover are added to forced.  Return the
+    // LP lower bound on the size of a vertex cover of what is left.  While
+    // this runs, the live vertices of vv are the ones that are not outside.
+    auto reduce(const vector<int> & vv, long reduced_trail_size, vector<int> & forced) -> int
+    {
+        for (int v : vv)
+            if (alive[v])
+                outside[v] = false;
+        if (reduced_trail_size == -1) {
+            for (int v : vv) {
+                if (alive[v]) {
+                    in_worklist[v] = true;
+                    worklist.push_back(v);
+                }
+            }
+        } else {
+            note_removed(reduced_trail_size);
+        }
+
+        int lp_bound;
+        while (true) {
+            while (!worklist.empty()) {
+                int v = worklist.back();
+                worklist.pop_back();
+                in_worklist[v] = false;
+                size_t trail_size = trail.size();
+                if (alive[v] && try_cheap_rules(v, forced))
+                    note_removed(trail_size);
+            }
+            size_t trail_size = trail.size();
+            lp_bound = try_lp_reduction(vv, forced);
+            if (lp_bound != -1)
+                break;
+            note_removed(trail_size);
+        }
+
+        for (int v : vv)
+            outside[v] = true;
+        return lp_bound;
+    }
+
+    // A lower bound on the size of a vertex cover of the live vertices vv: the
+    // number of vertices minus the number of cliques in a greedy clique cover
+    auto lower_bound(vector<int> & vv) -> int
+    {
+        std::sort(vv.begin(), vv.end(), [&](int v, int w) { return deg[v] < deg[w]; });
+        return vv.size() - clique_cover.count_cliques(g, vv, [&](int v) { return bool(alive[v]); });
+    }
+
+    auto connected_components(const vector<int> & vv) -> vector<vector<int>>
+    {
+        vector<vector<int>> components;
+        unsigned m = new_mark();
+        for (int v : vv) {
+            if (mark[v] == m)
+                continue;
+            components.emplace_back();
+            auto & component = components.back();
+            mark[v] = m;
+            component.push_back(v);
+            for (unsigned i=0; i<component.size(); i++)
+                for (int w : g.neighbours(component[i]))
+                    if (alive[w] && mark[w] != m) {
+                        mark[w] = m;
+                        component.push_back(w);
+                    }
+        }
+        return components;
+    }
+
+    // The mirrors of v: live vertices u at distance two such that the
+    // neighbours of v that are not adjacent to u form a clique.  There is a
+    // minimum vertex cover that either excludes v or includes v and all of
+    // its mirrors.
+    auto mirrors(int v) -> vector<int>
+    {
+        unsigned m = new_mark();
+        mark[v] = m;
+        for (int w : g.neighbours(v))
+            if (alive[w])
+                mark[w] = m;
+
+        vector<int> candidates;
+        unsigned candidate_mark = new_mark2();
+        for (int w : g.neighbours(v))
+            if (alive[w])
+                for (int u : g.neighbours(w))
+                    if (alive[u] && mark[u] != m && mark2[u] != candidate_mark) {
+                        mark2[u] = candidate_mark;
+                        candidates.push_back(u);
+                    }
+
+        vector<int> result;
+        for (int u : candidates) {
+            int num_common = 0;
+            for (int x : g.neighbours(u))
+                if (alive[x] && mark[x] == m)
+                    ++num_common;
+            if (deg[v] - num_common > MIRROR_MAX_CLIQUE_SIZE)
+                continue;
+
+            unsigned u_neighbour_mark = new_mark2();
+            for (int x : g.neighbours(u))
+                mark2[x] = u_neighbour_mark;
+            vector<int> missed;
+            for (int x : g.neighbours(v))
+                if (alive[x] && mark2[x] != u_neighbour_mark)
+                    missed.push_back(x);
+
+            bool is_clique = true;
+            for (unsigned i=0; i<missed.size() && is_clique; i++)
+                for (unsigned j=i+1; j<missed.size() && is_clique; j++)
+                    if (!g.has_edge(missed[i], missed[j]))
+                        is_clique = false;
+            if (is_clique)
+                result.push_back(u);
+        }
+        return result;
+    }
+
+    // Look for a vertex cover of the live vertices among vv with fewer than
+    // limit vertices.  If one is found, put it in cover and return its size;
+    // otherwise return limit.  The residual graph is restored before
+    // returning.  Once aborted is set, every search returns limit, so the
+    // best cover found so far stands.  reduced_trail_size is as for reduce().
+    auto search(const vector<int> & vv, int depth, long reduced_trail_size, int limit, vector<int> & cover,
+            long & search_node_count) -> int
+    {
+        ++search_node_count;
+        if (limit <= 0 || aborted.load(std::memory_order_relaxed))
+            return limit;
+
+        size_t trail_size = trail.size();
+        vector<int> forced;
+        int lp_bound = 0;
+        if (depth % reduce_interval == 0) {
+            lp_bound = reduce(vv, reduced_trail_size, forced);
+            reduced_trail_size = trail.size();
+        }
+        int num_forced = forced.size();
+
+        vector<int> rest;
+        long num_edge_ends = 0;
+        for (int v : vv) {
+            if (alive[v]) {
+                rest.push_back(v);
+                num_edge_ends += deg[v];
+            }
+        }
+
+        int result = limit;
+        if (num_forced >= limit) {
+            // pruned
+        } else if (num_edge_ends == 0) {
+            cover = forced;
+            result = num_forced;
+        } else if (num_forced + std::max(lp_bound, lower_bound(rest)) >= limit) {
+            // pruned
+        } else {
+            auto components = connected_components(rest);
+            if (components.size() > 1)
+                result = search_components(components, depth, reduced_trail_size, limit, forced, cover,
+                        search_node_count);
+            else
+                result = branch(rest, depth, reduced_trail_size, limit, forced, cover, search_node_count);
+        }
+
+        undo(trail_size);
+        return result;
+    }
+
+    // Solve the components one at a time, smallest first, giving each the
+    // budget that is left once the others' lower bounds are accounted for
+    auto search_components(vector<vector<int>> & components, int depth, long reduced_trail_size, int limit,
+            const vector<int> & forced, vector<int> & cover, long & search_node_count) -> int
+    {
+        std::sort(components.begin(), components.end(),
+                [](const vector<int> & a, const vector<int> & b) { return a.size() < b.size(); });
+        vector<int> bounds;
+        int total_of_bounds = 0;
+        for (auto & component : components) {
+            bounds.push_back(lower_bound(component));
+            total_of_bounds += bounds.back();
+        }
+
+        vector<int> result = forced;
+        int total = forced.size();
+        for (unsigned i=0; i<components.size(); i++) {
+            total_of_bounds -= bounds[i];
+            int component_limit = limit - total - total_of_bounds;
+            vector<int> component_cover;
+            int size = search(components[i], depth + 1, reduced_trail_size, component_limit, component_cover, search_node_count);
+            if (size >= component_limit)
+                return limit;
+            total += size;
+            result.insert(result.end(), component_cover.begin(), component_cover.end());
+        }
+        cover = result;
+        return total;
+    }
+
+    // Branch on a vertex v of maximum degree: either v and its mirrors are in
+    // the cover, or v's neighbours are
+    auto branch(const vector<int> & vv, int depth, long reduced_trail_size, int limit, const vector<int> & forced,
+            vector<int> & cover, long & search_node_count) -> int
+    {
+        int v = vv[0];
+        for (int w : vv)
+            if (deg[w] > deg[v])
+                v = w;
+        int num_forced = forced.size();
+        int best = limit;
+
+        for (int take_neighbours=0; take_neighbours<2; take_neighbours++) {
+            size_t trail_size = trail.size();
+            vector<int> taken;
+            if (take_neighbours) {
+                for (int w : g.neighbours(v))
+                    if (alive[w])
+                        taken.push_back(w);
+                for (int w : taken)
+                    remove(w);
+                remove(v);
+            } else {
+                taken = mirrors(v);
+                taken.push_back(v);
+                for (int w : taken)
+                    remove(w);
+            }
+
+            vector<int> rest;
+            for (int w : vv)
+                if (alive[w])
+                    rest.push_back(w);
+            int taken_size = taken.size();
+            vector<int> sub_cover;
+            int size = search(rest, depth + 1, reduced_trail_size, best - num_forced - taken_size, sub_cover, search_node_count);
+            if (size < best - num_forced - taken_size) {
+                best = num_forced + taken_size + size;
+                cover = forced;
+                cover.insert(cover.end(), taken.begin(), taken.end());
+                cover.insert(cover.end(), sub_cover.begin(), sub_cover.end());
+            }
+            undo(trail_size);
+        }
+        return best;
+    }
+
+public:
+    BranchAndReduce(const SparseGraph & g, int reduce_interval)
+            : g(g), reduce_interval(std::max(1, reduce_interval)), alive(g.n, true), deg(g.n),
+              mark(g.n), current_mark(0), mark2(g.n), current_mark2(0), lp(g.n), outside(g.n, true),
+              in_worklist(g.n),
+              clique_cover(g.n)
+    {
+        for (unsigned v=0; v<g.n; v++)
+            deg[v] = g.degree(v);
+    }
+
+    auto run(int limit, vector<int> & cover, long & search_node_count) -> bool
+    {
+        vector<int> vv;
+        for (unsigned v=0; v<g.n; v++)
+            vv.push_back(v);
+        return search(vv, 0, -1, limit, cover, search_node_count) < limit;
+    }
+};
+
+auto branch_and_reduce_vertex_cover(const SparseGraph & g, int reduce_interval, int limit,
+        vector<int> & cover, long & search_node_count) -> bool
+{
+    return BranchAndReduce(g, reduce_interval).run(limit, cover, search_node_count);
+}
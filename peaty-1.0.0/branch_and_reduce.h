@@ -0,0 +1,19 @@
+#ifndef BRANCH_AND_REDUCE_H
+#define BRANCH_AND_REDUCE_H
+
+#include "sparse_graph.h"
+
+#include <vector>
+
+using std::vector;
+
+// Look for a vertex cover of g with fewer than limit vertices by branch and
+// reduce: the cheap reduction rules are applied to the residual graph at
+// every reduce_interval-th level of the search tree, and the residual graph
+// is split into its connected components whenever branching disconnects it.
+// If a cover is found, it is a minimum vertex cover; it is put in cover and
+// true is returned.
+auto branch_and_reduce_vertex_cover(const SparseGraph & g, int reduce_interval, int limit,
+        vector<int> & cover, long & search_node_count) -> bool;
+
+#endif
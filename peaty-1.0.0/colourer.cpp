@@ -7,7 +7,9 @@ std::shared_ptr<Colourer> Colourer::create_colourer(Graph & g, const Params & pa
     case 2:
         return std::make_shared<UnitPropColourer>(g, params);
     case 3:
-        return std::make_shared<ClassEnlargingUnitPropColourer>(g, params);
+        return std::make_shared<ClassEnlargingUnitPropColourer>(g, params, false);
+    case 4:
+        return std::make_shared<ClassEnlargingUnitPropColourer>(g, params, true);
     default:   // option 0
         return std::make_shared<EvenSimplerColourer>(g, params);
     }
@@ -16,7 +18,7 @@ std::shared_ptr<Colourer> Colourer::create_colourer(Graph & g, const Params & pa
 int UnitPropagator::get_unique_remaining_vtx(const Clause & c) {
     unsigned i = 0;
     int v;
-    while (reason[v = c.vv[i]] != -1)
+    while (get_reason(v = c.vv[i]) != -1)
         ++i;
     assert(i < c.vv.size());
     return v;
@@ -28,7 +30,7 @@ void UnitPropagator::create_inconsistent_set(int c_idx, ListOfClauses & cc)
     unsigned j = 0;
     while (j != I.vals.size()) {
         for (int w : cc.clause[I.vals[j]].vv) {
-            int r = reason[w];
+            int r = get_reason(w);
             if (r != -1 && !I.on_stack[r]) {
                 I.push(r);
             }
@@ -37,11 +39,12 @@ void UnitPropagator::create_inconsistent_set(int c_idx, ListOfClauses & cc)
     }
 }
 
-// Return whether an inconsistent set has been found
+template<int Words>
 auto UnitPropagator::propagate_vertex(ListOfClauses & cc, int v, int u_idx,
         const vector<unsigned long long> & P_bitset) -> bool
 {
-    for (int i=0; i<g.numwords; i++) {
+    int numwords = Words ? Words : P_numwords;
+    for (int i=P_first_word; i<numwords; i++) {
         // iterate over vertices w that are in both P and the complement-graph
         // neighbourhood of v
         unsigned long long word = g.bit_complement_nd[v][i] & P_bitset[i];
@@ -49,13 +52,13 @@ auto UnitPropagator::propagate_vertex(ListOfClauses & cc, int v, int u_idx,
             int bit = __builtin_ctzll(word);
             word ^= (1ull << bit);
             int w = i*BITS_PER_WORD + bit;
-            if (reason[w] == -1) {
-                reason[w] = u_idx;
+            if (get_reason(w) == -1) {
+                set_reason(w, u_idx);
                 for (int c_idx : cm[w]) {
-                    remaining_vv_count[c_idx]--;
-                    if (remaining_vv_count[c_idx] == 1) {
+                    int remaining = decrement_remaining_vv_count(c_idx);
+                    if (remaining == 1) {
                         Q.enqueue(c_idx);
-                    } else if (remaining_vv_count[c_idx] == 0) {
+                    } else if (remaining == 0) {
                         create_inconsistent_set(c_idx, cc);
                         return true;
                     }
@@ -66,28 +69,164 @@ auto UnitPropagator::propagate_vertex(ListOfClauses & cc, int v, int u_idx,
     return false;
 }
 
+auto UnitPropagator::unit_propagate_once(ListOfClauses & cc, int first_clause_index, int first_v,
+        const vector<unsigned long long> & P_bitset) -> void
+{
+    if (params.bitset_unit_propagation) {
+        bitset_unit_propagate_once(cc, first_clause_index, first_v, P_bitset);
+        return;
+    }
+
+    dispatch_on_num_words(P_numwords, [&](auto words) {
+        unit_propagate_once<decltype(words)::value>(cc, first_clause_index, first_v, P_bitset);
+    });
+}
+
+template<int Words>
 auto UnitPropagator::unit_propagate_once(ListOfClauses & cc, int first_clause_index, int first_v,
         const vector<unsigned long long> & P_bitset) -> void
 {
     I.clear();
     Q.clear();
+    start_new_epoch();
 
-    remaining_vv_count = vv_count;
-    std::fill(vertex_has_been_propagated.begin(), vertex_has_been_propagated.end(), 0);
-    std::fill(reason.begin(), reason.end(), -1);
-
-    if (propagate_vertex(cc, first_v, first_clause_index, P_bitset))
+    if (propagate_vertex<Words>(cc, first_v, first_clause_index, P_bitset))
         return;
-    vertex_has_been_propagated[first_v] = true;
+    propagated_stamp[first_v] = epoch;
 
     while (!Q.empty()) {
         int u_idx = Q.dequeue();
         assert (remaining_vv_count[u_idx] == 1);
         int v = get_unique_remaining_vtx(cc.clause[u_idx]);
-        if (!vertex_has_been_propagated[v]) {
-            if (propagate_vertex(cc, v, u_idx, P_bitset))
+        if (propagated_stamp[v] != epoch) {
+            if (propagate_vertex<Words>(cc, v, u_idx, P_bitset))
                 return;
-            vertex_has_been_propagated[v] = true;
+            propagated_stamp[v] = epoch;
+        }
+    }
+}
+
+auto UnitPropagator::set_P_word_range(const vector<unsigned long long> & P_bitset) -> void
+{
+    P_numwords = calc_numwords(P_bitset, g.numwords);
+    P_first_word = P_numwords == 0 ? 0 : first_set_bit(P_bitset, P_numwords) / BITS_PER_WORD;
+}
+
+auto UnitPropagator::build_clause_bitsets(ListOfClauses & cc) -> void
+{
+    while (int(clause_vv_bitsets.size()) < cc.size) {
+        clause_vv_bitsets.emplace_back(g.numwords);
+        live_vv_bitsets.emplace_back(g.numwords);
+    }
+    for (int i=0; i<cc.size; i++) {
+        auto & bitset = clause_vv_bitsets[i];
+        for (int j=P_first_word; j<P_numwords; j++)
+            bitset[j] = 0;
+        for (int v : cc.clause[i].vv)
+            set_bit(bitset, v);
+    }
+}
+
+// The reasons of the falsified vertices of clause c_idx are the reasons of the
+// steps that falsified any of its vertices
+void UnitPropagator::bitset_create_inconsistent_set(int c_idx)
+{
+    I.push(c_idx);
+    unsigned j = 0;
+    while (j != I.vals.size()) {
+        auto & clause_bitset = clause_vv_bitsets[I.vals[j]];
+        for (int k=0; k<num_steps; k++) {
+            int r = step_reason[k];
+            if (I.on_stack[r])
+                continue;
+            auto & falsified = step_falsified_vv[k];
+            for (int i=P_first_word; i<P_numwords; i++) {
+                if (clause_bitset[i] & falsified[i]) {
+                    I.push(r);
+                    break;
+                }
+            }
+        }
+        ++j;
+    }
+}
+
+// Give reason u_idx to every vertex in P that is not adjacent to v and does not
+// already have a reason, and remove these vertices from the live bitsets of all
+// clauses.  Return whether an inconsistent set has been found.
+auto UnitPropagator::bitset_propagate_vertex(ListOfClauses & cc, int v, int u_idx,
+        const vector<unsigned long long> & P_bitset) -> bool
+{
+    if (num_steps == int(step_falsified_vv.size()))
+        step_falsified_vv.emplace_back(g.numwords);
+    auto & newly_falsified = step_falsified_vv[num_steps];
+
+    unsigned long long any_falsified = 0;
+    for (int i=P_first_word; i<P_numwords; i++) {
+        newly_falsified[i] = g.bit_complement_nd[v][i] & P_bitset[i] & ~falsified_vv_bitset[i];
+        falsified_vv_bitset[i] |= newly_falsified[i];
+        any_falsified |= newly_falsified[i];
+    }
+    if (!any_falsified)
+        return false;
+    step_reason[num_steps++] = u_idx;
+
+    for (int c_idx=0; c_idx<cc.size; c_idx++) {
+        // clauses with no remaining weight take no further part in propagation
+        if (cc.clause[c_idx].remaining_wt == 0)
+            continue;
+
+        auto & live = live_vv_bitsets[c_idx];
+        int i = P_first_word;
+        while (i < P_numwords && !(live[i] & newly_falsified[i]))
+            ++i;
+        if (i == P_numwords)
+            continue;
+
+        // count the live vertices, saturating at two per word; the clause
+        // had at least two live vertices before this step
+        int count = 0;
+        for (i=P_first_word; i<P_numwords; i++) {
+            unsigned long long word = live[i] & ~newly_falsified[i];
+            live[i] = word;
+            count += (word != 0) + ((word & (word - 1)) != 0);
+        }
+        if (count == 1) {
+            Q.enqueue(c_idx);
+        } else if (count == 0) {
+            bitset_create_inconsistent_set(c_idx);
+            return true;
+        }
+    }
+    return false;
+}
+
+auto UnitPropagator::bitset_unit_propagate_once(ListOfClauses & cc, int first_clause_index, int first_v,
+        const vector<unsigned long long> & P_bitset) -> void
+{
+    I.clear();
+    Q.clear();
+    start_new_epoch();
+    num_steps = 0;
+
+    for (int i=P_first_word; i<P_numwords; i++)
+        falsified_vv_bitset[i] = 0;
+    for (int c_idx=0; c_idx<cc.size; c_idx++)
+        if (cc.clause[c_idx].remaining_wt != 0)
+            for (int i=P_first_word; i<P_numwords; i++)
+                live_vv_bitsets[c_idx][i] = clause_vv_bitsets[c_idx][i];
+
+    if (bitset_propagate_vertex(cc, first_v, first_clause_index, P_bitset))
+        return;
+    propagated_stamp[first_v] = epoch;
+
+    while (!Q.empty()) {
+        int u_idx = Q.dequeue();
+        int v = first_set_bit(live_vv_bitsets[u_idx], P_first_word, P_numwords);
+        if (propagated_stamp[v] != epoch) {
+            if (bitset_propagate_vertex(cc, v, u_idx, P_bitset))
+                return;
+            propagated_stamp[v] = epoch;
         }
     }
 }
@@ -117,59 +256,111 @@ long UnitPropagator::process_inconsistent_set(IntStackWithoutDups & iset, ListOf
     for (int c_idx : iset.vals) {
         Clause & c = cc.clause[c_idx];
         c.remaining_wt -= min_wt;
-        if (c.remaining_wt == 0) {
+        if (c.remaining_wt == 0 && !params.bitset_unit_propagation) {
             // Remove references to this clause from CM
             for (int v : c.vv)
                 remove_from_clause_membership(v, c_idx);
         }
     }
     cc.clause[max_idx].weight -= min_wt;  // decrease weight of last clause in set
+
+    found_iset_clauses.insert(found_iset_clauses.end(), iset.vals.begin(), iset.vals.end());
+    found_iset_start.push_back(found_iset_clauses.size());
+    found_iset_wt.push_back(min_wt);
     return min_wt;
 }
 
-unsigned UnitPropagator::get_max_clause_size(const ListOfClauses & cc)
+// Every vertex in P is in at least one clause, so only the membership lists of
+// vertices in clauses need to be cleared.  Clauses with no remaining weight
+// are left out.
+auto UnitPropagator::build_clause_membership(ListOfClauses & cc) -> void
 {
-    unsigned max_size = 0;
+    for (int i=0; i<cc.size; i++)
+        for (int v : cc.clause[i].vv)
+            cm[v].clear();
+
     for (int i=0; i<cc.size; i++) {
-        unsigned sz = cc.clause[i].vv.size();
-        if (sz > max_size)
-            max_size = sz;
+        Clause & clause = cc.clause[i];
+        vv_count[i] = clause.vv.size();
+        if (clause.remaining_wt != 0)
+            for (int v : clause.vv)
+                cm[v].push_back(i);
     }
-    return max_size;
 }
 
-long UnitPropagator::unit_propagate(ListOfClauses & cc, long target_reduction, const vector<unsigned long long> & P_bitset)
+// A counting sort, which keeps clauses of equal size in index order
+auto UnitPropagator::sort_clauses_by_size(ListOfClauses & cc) -> void
 {
-    if (target_reduction <= 0)
-        return 0;
+    unsigned max_size = 0;
+    for (int i=0; i<cc.size; i++)
+        max_size = std::max(max_size, unsigned(cc.clause[i].vv.size()));
 
-    for (int v=0; v<g.n; v++)
-        cm[v].clear();
+    clause_size_start.assign(max_size + 2, 0);
+    for (int i=0; i<cc.size; i++)
+        ++clause_size_start[cc.clause[i].vv.size() + 1];
+    for (unsigned sz=1; sz<clause_size_start.size(); sz++)
+        clause_size_start[sz] += clause_size_start[sz - 1];
 
-    for (int i=0; i<cc.size; i++) {
-        Clause & clause = cc.clause[i];
-        vv_count[i] = clause.vv.size();
-        for (int v : clause.vv)
-            cm[v].push_back(i);
-    }
+    clauses_by_size.resize(cc.size);
+    for (int i=0; i<cc.size; i++)
+        clauses_by_size[clause_size_start[cc.clause[i].vv.size()]++] = i;
 
+    // each start was advanced to the end of its bucket; shift them back
+    for (unsigned sz=clause_size_start.size()-1; sz>0; sz--)
+        clause_size_start[sz] = clause_size_start[sz - 1];
+    clause_size_start[0] = 0;
+}
+
+long UnitPropagator::unit_propagate(ListOfClauses & cc, long target_reduction, const vector<unsigned long long> & P_bitset)
+{
     for (int i=0; i<cc.size; i++)
         cc.clause[i].remaining_wt = cc.clause[i].weight;
 
+    return continue_unit_propagation(cc, target_reduction, P_bitset);
+}
+
+long UnitPropagator::continue_unit_propagation(ListOfClauses & cc, long target_reduction,
+        const vector<unsigned long long> & P_bitset)
+{
+    if (!params.collect_stats)
+        return propagate(cc, target_reduction, P_bitset);
+
+    auto start = std::chrono::steady_clock::now();
+    long improvement = propagate(cc, target_reduction, P_bitset);
+    time_used += std::chrono::steady_clock::now() - start;
+    return improvement;
+}
+
+long UnitPropagator::propagate(ListOfClauses & cc, long target_reduction, const vector<unsigned long long> & P_bitset)
+{
+    found_iset_clauses.clear();
+    found_iset_start.assign(1, 0);
+    found_iset_wt.clear();
+
+    if (target_reduction <= 0)
+        return 0;
+
+    set_P_word_range(P_bitset);
+    if (params.bitset_unit_propagation)
+        build_clause_bitsets(cc);
+    else
+        build_clause_membership(cc);
+    sort_clauses_by_size(cc);
+
     long improvement = 0;
 
 #ifdef VERY_VERBOSE
     printf("VERY_VERBOSE {\"isets\": [");
     const char *sep = "";
 #endif
-    unsigned max_clause_size = params.max_sat_level == -1 ?
-            get_max_clause_size(cc) : params.max_sat_level;
+    unsigned max_clause_size = clause_size_start.size() - 2;
+    if (params.max_sat_level != -1)
+        max_clause_size = std::min(max_clause_size, unsigned(params.max_sat_level));
 
     for (unsigned clause_size = 1; clause_size <= max_clause_size; clause_size++) {
-        for (int i=0; i<cc.size; i++) {
+        for (int j=clause_size_start[clause_size]; j<clause_size_start[clause_size + 1]; j++) {
+            int i = clauses_by_size[j];
             Clause & clause = cc.clause[i];
-            if (clause.vv.size() != clause_size)
-                continue;
 
             for (;;) {
                 if (clause.remaining_wt == 0)
@@ -216,22 +407,22 @@ long UnitPropagator::unit_propagate(ListOfClauses & cc, long target_reduction, c
 int UnitPropagator::unit_propagate_m1(ListOfClauses & cc, long target_reduction, long target,
         const vector<unsigned long long> & P_bitset)
 {
+    found_iset_clauses.clear();
+    found_iset_start.assign(1, 0);
+    found_iset_wt.clear();
+
     if (target_reduction <= 0)
         return cc.size;
 
-    for (int v=0; v<g.n; v++)
-        cm[v].clear();
-
-    for (int i=0; i<cc.size; i++) {
-        Clause & clause = cc.clause[i];
-        vv_count[i] = clause.vv.size();
-        for (int v : clause.vv)
-            cm[v].push_back(i);
-    }
-
     for (int i=0; i<cc.size; i++)
         cc.clause[i].remaining_wt = cc.clause[i].weight;
 
+    set_P_word_range(P_bitset);
+    if (params.bitset_unit_propagation)
+        build_clause_bitsets(cc);
+    else
+        build_clause_membership(cc);
+
     long improvement = 0;
 
     long bound = 0;
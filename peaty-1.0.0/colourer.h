@@ -7,6 +7,7 @@
 #include "fast_int_queue.h"
 #include "graph.h"
 #include "int_stack_without_dups.h"
+#include "stats.h"
 #include "util.h"
 
 #include <algorithm>
@@ -43,22 +44,107 @@ class UnitPropagator {
     ClauseMembership cm;
 
     vector<int> vv_count;
+
+    // The per-propagation state below is reset in constant time at the start of
+    // each call to unit_propagate_once, by incrementing epoch.  An entry is only
+    // valid if its stamp is equal to epoch.
+    unsigned epoch;
+
+    // the number of vertices in each clause without a reason; an entry whose
+    // stamp is out of date stands for the clause's vv_count
     vector<int> remaining_vv_count;
+    vector<unsigned> remaining_vv_count_stamp;
 
-    vector<unsigned char> vertex_has_been_propagated;  // really a vector of bools
+    // a vertex has been propagated iff its stamp is equal to epoch
+    vector<unsigned> propagated_stamp;
 
     // in unit_propagate_once, every vertex has a clause index as its reason,
-    // or -1 if the vertex does not have a reason
+    // or -1 if the vertex does not have a reason (its stamp is out of date)
     vector<int> reason;
+    vector<unsigned> reason_stamp;
+
+    // clause indices sorted by clause size; the clauses of size s are
+    // clauses_by_size[clause_size_start[s]] to clauses_by_size[clause_size_start[s+1]-1]
+    vector<int> clauses_by_size;
+    vector<int> clause_size_start;
+
+    auto start_new_epoch() -> void
+    {
+        if (++epoch == 0) {
+            std::fill(remaining_vv_count_stamp.begin(), remaining_vv_count_stamp.end(), 0);
+            std::fill(propagated_stamp.begin(), propagated_stamp.end(), 0);
+            std::fill(reason_stamp.begin(), reason_stamp.end(), 0);
+            epoch = 1;
+        }
+    }
+
+    auto get_reason(int v) -> int
+    {
+        return reason_stamp[v] == epoch ? reason[v] : -1;
+    }
+
+    auto set_reason(int v, int c_idx) -> void
+    {
+        reason[v] = c_idx;
+        reason_stamp[v] = epoch;
+    }
+
+    // Decrement the remaining vertex count of a clause, and return the new count
+    auto decrement_remaining_vv_count(int c_idx) -> int
+    {
+        if (remaining_vv_count_stamp[c_idx] != epoch) {
+            remaining_vv_count[c_idx] = vv_count[c_idx];
+            remaining_vv_count_stamp[c_idx] = epoch;
+        }
+        return --remaining_vv_count[c_idx];
+    }
+
+    auto build_clause_membership(ListOfClauses & cc) -> void;
+
+    auto sort_clauses_by_size(ListOfClauses & cc) -> void;
+
+    // the words of P_bitset that may be non-zero, set by set_P_word_range()
+    int P_first_word;
+    int P_numwords;
+
+    auto set_P_word_range(const vector<unsigned long long> & P_bitset) -> void;
+
+    // State for word-parallel propagation (params.bitset_unit_propagation).
+    // Each clause has a bitset of its vertices, and a bitset of its live
+    // vertices (those without a reason).  Reasons are recorded per propagation
+    // step rather than per vertex: step k gave the vertices in
+    // step_falsified_vv[k] the reason step_reason[k].
+    vector<vector<unsigned long long>> clause_vv_bitsets;
+    vector<vector<unsigned long long>> live_vv_bitsets;
+    vector<unsigned long long> falsified_vv_bitset;
+    vector<vector<unsigned long long>> step_falsified_vv;
+    vector<int> step_reason;
+    int num_steps;
+
+    auto build_clause_bitsets(ListOfClauses & cc) -> void;
+
+    void bitset_create_inconsistent_set(int c_idx);
+
+    auto bitset_propagate_vertex(ListOfClauses & cc, int v, int u_idx,
+            const vector<unsigned long long> & P_bitset) -> bool;
+
+    auto bitset_unit_propagate_once(ListOfClauses & cc, int first_clause_index, int first_v,
+            const vector<unsigned long long> & P_bitset) -> void;
 
     int get_unique_remaining_vtx(const Clause & c);
 
     void create_inconsistent_set(int c_idx, ListOfClauses & cc);
 
-    // Return whether an inconsistent set has been found
+    // Return whether an inconsistent set has been found.  Words is P_numwords,
+    // or 0 if P_numwords is greater than MAX_FIXED_NUM_WORDS.
+    template<int Words>
     auto propagate_vertex(ListOfClauses & cc, int v, int u_idx,
             const vector<unsigned long long> & P_bitset) -> bool;
 
+    template<int Words>
+    auto unit_propagate_once(ListOfClauses & cc, int first_clause_index, int first_v,
+            const vector<unsigned long long> & P_bitset) -> void;
+
     auto unit_propagate_once(ListOfClauses & cc, int first_clause_index, int first_v,
             const vector<unsigned long long> & P_bitset) -> void;
 
@@ -66,17 +152,35 @@ class UnitPropagator {
 
     long process_inconsistent_set(IntStackWithoutDups & iset, ListOfClauses & cc);
 
-    unsigned get_max_clause_size(const ListOfClauses & cc);
+    long propagate(ListOfClauses & cc, long target_reduction, const vector<unsigned long long> & P_bitset);
 
 public:
+    // the time spent in unit_propagate and continue_unit_propagation, if
+    // params.collect_stats is set
+    Duration time_used {};
+
+    // The inconsistent sets found by the last call to unit_propagate,
+    // continue_unit_propagation or unit_propagate_m1.  The clauses of set k are
+    // found_iset_clauses[found_iset_start[k]] to found_iset_clauses[found_iset_start[k+1]-1],
+    // and the set reduced the bound by found_iset_wt[k].
+    vector<int> found_iset_clauses;
+    vector<int> found_iset_start;
+    vector<long> found_iset_wt;
+
     UnitPropagator(Graph & g, const Params params)
-            : g(g), params(params), Q(g.n), I(g.n), iset(g.n), cm(g.n), vv_count(g.n), remaining_vv_count(g.n),
-              vertex_has_been_propagated(g.n), reason(g.n)
+            : g(g), params(params), Q(g.n), I(g.n), iset(g.n), cm(g.n), vv_count(g.n), epoch(0),
+              remaining_vv_count(g.n), remaining_vv_count_stamp(g.n), propagated_stamp(g.n),
+              reason(g.n), reason_stamp(g.n), falsified_vv_bitset(g.numwords), step_reason(g.n), num_steps(0)
     {
     }
 
     long unit_propagate(ListOfClauses & cc, long target_reduction, const vector<unsigned long long> & P_bitset);
 
+    // Like unit_propagate, but starting from the clauses' current remaining
+    // weights; clauses whose remaining weight is already zero take no part.
+    long continue_unit_propagation(ListOfClauses & cc, long target_reduction,
+            const vector<unsigned long long> & P_bitset);
+
     int unit_propagate_m1(ListOfClauses & cc, long target_reduction, long target,
             const vector<unsigned long long> & P_bitset);
 };
@@ -89,9 +193,34 @@ public:
     virtual auto colouring_bound(vector<unsigned long long> & P_bitset,
             vector<unsigned long long> & branch_vv_bitset, long target) -> bool = 0;
 
+    // the part of the time in colouring_bound that was spent in unit
+    // propagation, if params.collect_stats is set
+    virtual auto unit_propagation_time() const -> Duration
+    {
+        return Duration::zero();
+    }
+
     static std::shared_ptr<Colourer> create_colourer(Graph & g, const Params & params);
 };
 
+// A node's colouring, and the inconsistent sets that MaxSAT reasoning found
+// for it.  The clauses restricted to any subset of P_bitset are still a
+// colouring, and each inconsistent set is still inconsistent if none of its
+// clauses becomes empty, so a descendant can build a bound from these.
+struct ColouringRecord
+{
+    vector<unsigned long long> P_bitset;
+    vector<vector<int>> clause_vv;
+    vector<long> clause_wt;    // weights before MaxSAT reasoning
+    int num_clauses;
+
+    // the clauses of inconsistent set k are iset_clauses[iset_start[k]] to
+    // iset_clauses[iset_start[k+1]-1], and it reduced the bound by iset_wt[k]
+    vector<int> iset_clauses;
+    vector<int> iset_start;
+    vector<long> iset_wt;
+};
+
 class ClassEnlargingUnitPropColourer : public Colourer {
     Graph & g;
     const Params params;
@@ -104,21 +233,55 @@ class ClassEnlargingUnitPropColourer : public Colourer {
     vector<vector<unsigned long long>> candidates;
     vector<long> residual_wt;
 
+    // Incremental mode (colouring variant 4), in the style of IncMaxCLQ.
+    // records[0] to records[num_records-1] is a stack of the colourings of
+    // expanded nodes.  A node first tries to prune using the colouring on top
+    // of the stack, once the records whose P does not contain its own P have
+    // been popped: the clauses are restricted to P, the inconsistent sets that
+    // survive are reapplied, and MaxSAT reasoning runs only on the clauses that
+    // still have weight.  Otherwise, the node is coloured from scratch, and
+    // branches using whichever colouring gives the smaller branching set.
+    bool incremental;
+    vector<ColouringRecord> records;
+    int num_records;
+
+    vector<long> wt_before_maxsat;
+    vector<int> restricted_size;
+    vector<int> restricted_order;
+    vector<int> size_start;
+    vector<int> parent_to_child_clause;
+    IntStackWithoutDups reused_iset;
+    vector<int> reused_iset_clauses;
+    vector<int> reused_iset_start;
+    vector<long> reused_iset_wt;
+
+    // the restricted colouring, while the node is coloured from scratch
+    ListOfClauses restricted_cc;
+    ColouringRecord restricted_record;
+
 public:
-    ClassEnlargingUnitPropColourer(Graph & g, const Params params)
+    ClassEnlargingUnitPropColourer(Graph & g, const Params params, bool incremental)
             : g(g), params(params), unit_propagator(g, params), cc(g.n),
               to_colour(g.numwords),
               candidates(2, vector<unsigned long long>(g.numwords)),
-              residual_wt(g.n)
+              residual_wt(g.n),
+              incremental(incremental), num_records(0),
+              wt_before_maxsat(g.n), restricted_size(g.n), parent_to_child_clause(g.n),
+              reused_iset(g.n), restricted_cc(g.n)
+    {
+    }
+
+    auto unit_propagation_time() const -> Duration
     {
+        return unit_propagator.time_used;
     }
 
-    auto try_to_enlarge_clause(Clause & clause, int numwords,
+    auto try_to_enlarge_clause(Clause & clause, int first_word, int numwords,
             vector<unsigned long long> & candidates, vector<unsigned long long> & to_colour) -> void
     {
         vv.clear();
 
-        bitset_foreach(candidates, [this](int v){ vv.push_back(v); }, numwords);
+        bitset_foreach(candidates, [this](int v){ vv.push_back(v); }, first_word, numwords);
 
         int sz = vv.size();
         for (int sum=0; sum<=sz*2-3; sum++) {
@@ -137,11 +300,14 @@ public:
             }
         }
     }
-    bool colouring_bound(vector<unsigned long long> & P_bitset,
-            vector<unsigned long long> & branch_vv_bitset, long target)
-    {
-        int numwords = calc_numwords(P_bitset, g.numwords);
 
+    // Colour P greedily into cc, with the clauses sorted by decreasing size,
+    // and return the bound.  Words is numwords, or 0 if numwords is greater
+    // than MAX_FIXED_NUM_WORDS.
+    template<int Words>
+    auto colour(vector<unsigned long long> & P_bitset, int dynamic_numwords) -> long
+    {
+        int numwords = Words ? Words : dynamic_numwords;
         copy_bitset(P_bitset, to_colour, numwords);
         residual_wt = g.weight;
         cc.clear();
@@ -149,21 +315,30 @@ public:
         long bound = 0;
         int v;
         int w = 0;
-        while ((v=first_set_bit(to_colour, numwords))!=-1) {
+        // Vertices are only ever removed from to_colour, and each candidates set
+        // contains only vertices after the one that was added to the clause, so
+        // none of these bitsets has a set bit before its first_word.
+        int first_word = 0;
+        int candidates_first_word[2];
+        while ((v=first_set_bit(to_colour, first_word, numwords))!=-1) {
+            first_word = v / BITS_PER_WORD;
             Clause & clause = cc.clause[cc.size];
             clause.vv.clear();
             clause.vv.push_back(v);
-            bitset_intersection(to_colour, g.bit_complement_nd[v], candidates[0], numwords);
+            bitset_intersection(to_colour, g.bit_complement_nd[v], candidates[0], first_word, numwords);
+            candidates_first_word[0] = first_word;
             int i = 0;
-            while ((v=first_set_bit(candidates[i], numwords))!=-1) {
+            while ((v=first_set_bit(candidates[i], candidates_first_word[i], numwords))!=-1) {
                 clause.vv.push_back(v);
-                bitset_intersection(candidates[i], g.bit_complement_nd[v], candidates[!i], numwords);
+                candidates_first_word[!i] = v / BITS_PER_WORD;
+                bitset_intersection(candidates[i], g.bit_complement_nd[v], candidates[!i],
+                        candidates_first_word[!i], numwords);
                 i = !i;
                 w = v;
             }
             if (clause.vv.size() > 1) {
                 unset_bit(candidates[!i], w);
-                try_to_enlarge_clause(clause, numwords, candidates[!i], to_colour);
+                try_to_enlarge_clause(clause, candidates_first_word[!i], numwords, candidates[!i], to_colour);
             }
             long class_min_wt = residual_wt[clause.vv[0]];
             for (unsigned i=1; i<clause.vv.size(); i++) {
@@ -188,22 +363,219 @@ public:
         std::sort(cc.clause.begin(), std::next(cc.clause.begin(), cc.size),
                 [](auto & a, auto & b){return a.sorting_score > b.sorting_score;});
 
-        long improvement = unit_propagator.unit_propagate(cc, bound-target, P_bitset);
+        return bound;
+    }
 
-        bool proved_we_can_prune = bound-improvement <= target;
+    // Pop the records whose P does not contain P_bitset, and return the top
+    // record, or nullptr if the stack is empty
+    auto find_ancestor_record(vector<unsigned long long> & P_bitset, int numwords) -> const ColouringRecord *
+    {
+        while (num_records != 0 && !bitset_is_subset(P_bitset, records[num_records - 1].P_bitset, numwords))
+            --num_records;
+        return num_records == 0 ? nullptr : &records[num_records - 1];
+    }
 
-        if (!proved_we_can_prune) {
-            bound = 0;
-            for (int i=0; i<cc.size; i++) {
-                Clause & clause = cc.clause[i];
-                assert (clause.weight >= 0);
-                bound += clause.weight;
-                if (bound > target)
-                    for (int w : clause.vv)
-                        set_bit(branch_vv_bitset, w);
+    // Set cc to the clauses of record restricted to P, dropping those that
+    // become empty and keeping the others in order of decreasing size, and
+    // return the bound
+    auto restrict_colouring(const ColouringRecord & record, vector<unsigned long long> & P_bitset) -> long
+    {
+        // a counting sort by decreasing size, which keeps clauses of equal
+        // size in the record's order
+        int max_size = 0;
+        for (int i=0; i<record.num_clauses; i++) {
+            int sz = 0;
+            for (int v : record.clause_vv[i])
+                sz += test_bit(P_bitset, v);
+            restricted_size[i] = sz;
+            max_size = std::max(max_size, sz);
+        }
+        size_start.assign(max_size + 2, 0);
+        for (int i=0; i<record.num_clauses; i++)
+            ++size_start[max_size - restricted_size[i] + 1];
+        for (int k=1; k<=max_size + 1; k++)
+            size_start[k] += size_start[k - 1];
+        restricted_order.resize(record.num_clauses);
+        for (int i=0; i<record.num_clauses; i++)
+            restricted_order[size_start[max_size - restricted_size[i]]++] = i;
+
+        cc.clear();
+        long bound = 0;
+        for (int i : restricted_order) {
+            if (restricted_size[i] == 0) {
+                parent_to_child_clause[i] = -1;
+                continue;
             }
+            Clause & clause = cc.clause[cc.size];
+            clause.vv.clear();
+            for (int v : record.clause_vv[i])
+                if (test_bit(P_bitset, v))
+                    clause.vv.push_back(v);
+            clause.weight = record.clause_wt[i];
+            clause.remaining_wt = clause.weight;
+            bound += clause.weight;
+            parent_to_child_clause[i] = cc.size;
+            cc.size++;
         }
-        return !proved_we_can_prune;
+        return bound;
+    }
+
+    // Reapply the record's inconsistent sets whose clauses are all still in
+    // cc, in the order in which they were found, until the improvement reaches
+    // target_reduction.  Return the improvement.
+    auto reuse_inconsistent_sets(const ColouringRecord & record, long target_reduction) -> long
+    {
+        reused_iset_clauses.clear();
+        reused_iset_start.assign(1, 0);
+        reused_iset_wt.clear();
+
+        long improvement = 0;
+        for (unsigned k=0; k<record.iset_wt.size() && improvement<target_reduction; k++) {
+            long wt = record.iset_wt[k];
+            reused_iset.clear();
+            bool usable = true;
+            for (int j=record.iset_start[k]; j<record.iset_start[k + 1]; j++) {
+                int c_idx = parent_to_child_clause[record.iset_clauses[j]];
+                if (c_idx == -1 || cc.clause[c_idx].remaining_wt < wt) {
+                    usable = false;
+                    break;
+                }
+                reused_iset.push(c_idx);
+            }
+            if (!usable)
+                continue;
+
+            // as in UnitPropagator::process_inconsistent_set, the bound
+            // reduction is charged to the set's last clause
+            int max_idx = reused_iset.vals[0];
+            for (int c_idx : reused_iset.vals) {
+                cc.clause[c_idx].remaining_wt -= wt;
+                max_idx = std::max(max_idx, c_idx);
+            }
+            cc.clause[max_idx].weight -= wt;
+            improvement += wt;
+
+            reused_iset_clauses.insert(reused_iset_clauses.end(), reused_iset.vals.begin(), reused_iset.vals.end());
+            reused_iset_start.push_back(reused_iset_clauses.size());
+            reused_iset_wt.push_back(wt);
+        }
+        return improvement;
+    }
+
+    // Record cc, with the inconsistent sets that were reused for it (if
+    // reused_isets is true) and those that the unit propagator found for it
+    auto fill_record(ColouringRecord & record, vector<unsigned long long> & P_bitset, bool reused_isets) -> void
+    {
+        record.P_bitset = P_bitset;
+        if (int(record.clause_vv.size()) < cc.size) {
+            record.clause_vv.resize(cc.size);
+            record.clause_wt.resize(cc.size);
+        }
+        for (int i=0; i<cc.size; i++) {
+            record.clause_vv[i] = cc.clause[i].vv;
+            record.clause_wt[i] = wt_before_maxsat[i];
+        }
+        record.num_clauses = cc.size;
+
+        record.iset_clauses.clear();
+        record.iset_start.assign(1, 0);
+        record.iset_wt.clear();
+        if (reused_isets) {
+            record.iset_clauses = reused_iset_clauses;
+            record.iset_start = reused_iset_start;
+            record.iset_wt = reused_iset_wt;
+        }
+        auto & up = unit_propagator;
+        for (unsigned k=0; k<up.found_iset_wt.size(); k++) {
+            record.iset_clauses.insert(record.iset_clauses.end(),
+                    up.found_iset_clauses.begin() + up.found_iset_start[k],
+                    up.found_iset_clauses.begin() + up.found_iset_start[k + 1]);
+            record.iset_start.push_back(record.iset_clauses.size());
+            record.iset_wt.push_back(up.found_iset_wt[k]);
+        }
+    }
+
+    auto push_record() -> ColouringRecord &
+    {
+        if (num_records == int(records.size()))
+            records.emplace_back();
+        return records[num_records++];
+    }
+
+    auto save_weights_before_maxsat() -> void
+    {
+        for (int i=0; i<cc.size; i++)
+            wt_before_maxsat[i] = cc.clause[i].weight;
+    }
+
+    // The number of vertices that set_branch_vv would add to the branching set
+    auto count_branch_vv(long target) -> int
+    {
+        long bound = 0;
+        int count = 0;
+        for (int i=0; i<cc.size; i++) {
+            bound += cc.clause[i].weight;
+            if (bound > target)
+                count += cc.clause[i].vv.size();
+        }
+        return count;
+    }
+
+    auto set_branch_vv(vector<unsigned long long> & branch_vv_bitset, long target) -> void
+    {
+        long bound = 0;
+        for (int i=0; i<cc.size; i++) {
+            Clause & clause = cc.clause[i];
+            assert (clause.weight >= 0);
+            bound += clause.weight;
+            if (bound > target)
+                for (int w : clause.vv)
+                    set_bit(branch_vv_bitset, w);
+        }
+    }
+
+    bool colouring_bound(vector<unsigned long long> & P_bitset,
+            vector<unsigned long long> & branch_vv_bitset, long target)
+    {
+        int numwords = calc_numwords(P_bitset, g.numwords);
+
+        bool have_restricted_colouring = false;
+        int restricted_branch_count = 0;
+        if (incremental) {
+            const ColouringRecord * ancestor = find_ancestor_record(P_bitset, numwords);
+            if (ancestor) {
+                long bound = restrict_colouring(*ancestor, P_bitset);
+                save_weights_before_maxsat();
+                long improvement = reuse_inconsistent_sets(*ancestor, bound-target);
+                improvement += unit_propagator.continue_unit_propagation(cc, bound-improvement-target, P_bitset);
+                if (bound-improvement <= target)
+                    return false;
+
+                have_restricted_colouring = true;
+                restricted_branch_count = count_branch_vv(target);
+                fill_record(restricted_record, P_bitset, true);
+                std::swap(cc, restricted_cc);
+            }
+        }
+
+        long bound = dispatch_on_num_words(numwords, [&](auto words) {
+            return colour<decltype(words)::value>(P_bitset, numwords);
+        });
+        if (incremental)
+            save_weights_before_maxsat();
+        long improvement = unit_propagator.unit_propagate(cc, bound-target, P_bitset);
+
+        if (bound-improvement <= target)
+            return false;
+
+        if (have_restricted_colouring && restricted_branch_count < count_branch_vv(target)) {
+            std::swap(cc, restricted_cc);
+            std::swap(push_record(), restricted_record);
+        } else if (incremental) {
+            fill_record(push_record(), P_bitset, false);
+        }
+        set_branch_vv(branch_vv_bitset, target);
+        return true;
     }
 };
 
@@ -227,10 +599,26 @@ public:
     {
     }
 
+    auto unit_propagation_time() const -> Duration
+    {
+        return unit_propagator.time_used;
+    }
+
     bool colouring_bound(vector<unsigned long long> & P_bitset,
             vector<unsigned long long> & branch_vv_bitset, long target)
     {
         int numwords = calc_numwords(P_bitset, g.numwords);
+        return dispatch_on_num_words(numwords, [&](auto words) {
+            return colouring_bound<decltype(words)::value>(P_bitset, branch_vv_bitset, target, numwords);
+        });
+    }
+
+    // Words is numwords, or 0 if numwords is greater than MAX_FIXED_NUM_WORDS
+    template<int Words>
+    bool colouring_bound(vector<unsigned long long> & P_bitset,
+            vector<unsigned long long> & branch_vv_bitset, long target, int dynamic_numwords)
+    {
+        int numwords = Words ? Words : dynamic_numwords;
 
         copy_bitset(P_bitset, to_colour, numwords);
         residual_wt = g.weight;
@@ -238,17 +626,21 @@ public:
 
         long bound = 0;
         int v;
-        while ((v=first_set_bit(to_colour, numwords))!=-1) {
+        int first_word = 0;
+        while ((v=first_set_bit(to_colour, first_word, numwords))!=-1) {
+            first_word = v / BITS_PER_WORD;
             Clause & clause = cc.clause[cc.size];
             clause.vv.clear();
             clause.vv.push_back(v);
             long class_min_wt = residual_wt[v];
-            bitset_intersection(to_colour, g.bit_complement_nd[v], candidates, numwords);
-            while ((v=first_set_bit(candidates, numwords))!=-1) {
+            bitset_intersection(to_colour, g.bit_complement_nd[v], candidates, first_word, numwords);
+            int candidates_first_word = first_word;
+            while ((v=first_set_bit(candidates, candidates_first_word, numwords))!=-1) {
+                candidates_first_word = v / BITS_PER_WORD;
                 if (residual_wt[v] < class_min_wt)
                     class_min_wt = residual_wt[v];
                 clause.vv.push_back(v);
-                bitset_intersect_with(candidates, g.bit_complement_nd[v], numwords);
+                bitset_intersect_with(candidates, g.bit_complement_nd[v], candidates_first_word, numwords);
             }
 
             for (int w : clause.vv) {
@@ -299,22 +691,37 @@ public:
             vector<unsigned long long> & branch_vv_bitset, long target) -> bool
     {
         int numwords = calc_numwords(P_bitset, g.numwords);
+        return dispatch_on_num_words(numwords, [&](auto words) {
+            return colouring_bound<decltype(words)::value>(P_bitset, branch_vv_bitset, target, numwords);
+        });
+    }
+
+    // Words is numwords, or 0 if numwords is greater than MAX_FIXED_NUM_WORDS
+    template<int Words>
+    auto colouring_bound(vector<unsigned long long> & P_bitset,
+            vector<unsigned long long> & branch_vv_bitset, long target, int dynamic_numwords) -> bool
+    {
+        int numwords = Words ? Words : dynamic_numwords;
 
         copy_bitset(P_bitset, branch_vv_bitset, numwords);
         residual_wt = g.weight;
 
         long bound = 0;
         int v;
-        while ((v=first_set_bit(branch_vv_bitset, numwords))!=-1) {
+        int first_word = 0;
+        while ((v=first_set_bit(branch_vv_bitset, first_word, numwords))!=-1) {
+            first_word = v / BITS_PER_WORD;
             long class_min_wt = residual_wt[v];
             col_class.clear();
             col_class.push_back(v);
-            bitset_intersection(branch_vv_bitset, g.bit_complement_nd[v], candidates, numwords);
-            while ((v=first_set_bit(candidates, numwords))!=-1) {
+            bitset_intersection(branch_vv_bitset, g.bit_complement_nd[v], candidates, first_word, numwords);
+            int candidates_first_word = first_word;
+            while ((v=first_set_bit(candidates, candidates_first_word, numwords))!=-1) {
+                candidates_first_word = v / BITS_PER_WORD;
                 if (residual_wt[v] < class_min_wt)
                     class_min_wt = residual_wt[v];
                 col_class.push_back(v);
-                bitset_intersect_with(candidates, g.bit_complement_nd[v], numwords);
+                bitset_intersect_with(candidates, g.bit_complement_nd[v], candidates_first_word, numwords);
             }
             bound += class_min_wt;
             if (bound > target) {
@@ -0,0 +1,183 @@
+#include "csr_snapshot.h"
+#include "sparse_graph.h"
+#include "util.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+// Round a number of bytes up to a whole number of 8-byte words
+static auto padded(uint64_t num_bytes) -> uint64_t
+{
+    return (num_bytes + 7) / 8 * 8;
+}
+
+// The size of everything after the header
+static auto body_size(uint64_t n, uint64_t num_adj_entries) -> uint64_t
+{
+    return padded((n + 1) * sizeof(uint64_t)) + padded(num_adj_entries * sizeof(int32_t)) +
+            padded(n * sizeof(int64_t)) + padded(n * sizeof(uint8_t));
+}
+
+// Add one word to a running checksum
+static auto update_checksum(uint64_t checksum, uint64_t word) -> uint64_t
+{
+    checksum = (checksum ^ word) * 0x100000001b3ull;
+    return checksum ^ (checksum >> 29);
+}
+
+// Add num_bytes bytes, a multiple of 8, to a running checksum one word at a time
+static auto update_checksum(uint64_t checksum, const void * data, uint64_t num_bytes) -> uint64_t
+{
+    auto bytes = static_cast<const char *>(data);
+    for (uint64_t i=0; i<num_bytes; i+=8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        checksum = update_checksum(checksum, word);
+    }
+    return checksum;
+}
+
+#define CHECKSUM_SEED 0xcbf29ce484222325ull
+
+CsrSnapshot::CsrSnapshot()
+{
+    const char * p = input.begin();
+    uint64_t file_size = input.end() - p;
+
+    CsrSnapshotHeader header;
+    if (file_size < sizeof(header))
+        fail("The CSR snapshot is too short.");
+    memcpy(&header, p, sizeof(header));
+    if (memcmp(header.magic, CSR_SNAPSHOT_MAGIC, sizeof(header.magic)))
+        fail("The input is not a CSR snapshot.");
+    if (header.version != CSR_SNAPSHOT_VERSION)
+        fail("Unsupported CSR snapshot version.");
+    if (header.byte_order_mark != CSR_SNAPSHOT_BYTE_ORDER_MARK)
+        fail("The CSR snapshot was written on a machine with a different byte order.");
+    if (header.n > INT_MAX || header.num_adj_entries > file_size ||
+            file_size != sizeof(header) + body_size(header.n, header.num_adj_entries))
+        fail("The CSR snapshot has the wrong size.");
+
+    const char * body = p + sizeof(header);
+    n = header.n;
+    num_adj_entries = header.num_adj_entries;
+    offsets = reinterpret_cast<const uint64_t *>(body);
+    body += padded((n + 1) * sizeof(uint64_t));
+    neighbours = reinterpret_cast<const int32_t *>(body);
+    body += padded(num_adj_entries * sizeof(int32_t));
+    weights = reinterpret_cast<const int64_t *>(body);
+    body += padded(n * sizeof(int64_t));
+    has_loop = reinterpret_cast<const uint8_t *>(body);
+
+    // A snapshot with a good checksum can still have been written wrongly, and
+    // SparseGraph trusts the lists it is given, so the format is checked while
+    // the checksum is computed: the offsets must run from 0 to num_adj_entries
+    // without decreasing, and each list must be strictly increasing, without
+    // v itself, and made of vertices.  The offsets fill whole words, and each
+    // word of the neighbours array holds two entries.
+    uint64_t checksum = CHECKSUM_SEED;
+    bool offsets_ok = offsets[0] == 0 && offsets[n] == num_adj_entries;
+    for (uint64_t v=0; v<=n; v++) {
+        checksum = update_checksum(checksum, offsets[v]);
+        if (v != 0 && offsets[v] < offsets[v - 1])
+            offsets_ok = false;
+    }
+    bool neighbours_ok = true;
+    bool lists_ok = true;
+    uint64_t v = 0;    // the vertex whose list holds the current entry
+    auto neighbour_bytes = reinterpret_cast<const char *>(neighbours);
+    for (uint64_t i=0; i<num_adj_entries; i+=2) {
+        uint64_t word;
+        memcpy(&word, neighbour_bytes + i * sizeof(int32_t), 8);
+        checksum = update_checksum(checksum, word);
+        for (uint64_t j=i; j<i+2 && j<num_adj_entries; j++) {
+            if (neighbours[j] < 0 || uint64_t(neighbours[j]) >= n)
+                neighbours_ok = false;
+            if (!offsets_ok)
+                continue;
+            while (offsets[v + 1] <= j)
+                ++v;
+            if (uint64_t(neighbours[j]) == v || (j != offsets[v] && neighbours[j] <= neighbours[j - 1]))
+                lists_ok = false;
+        }
+    }
+    checksum = update_checksum(checksum, weights, p + file_size - reinterpret_cast<const char *>(weights));
+    if (checksum != header.checksum)
+        fail("The CSR snapshot's checksum is wrong.");
+    if (!offsets_ok)
+        fail("The CSR snapshot's offsets are inconsistent.");
+    if (!neighbours_ok)
+        fail("The CSR snapshot has a neighbour that is not a vertex.");
+    if (!lists_ok)
+        fail("The CSR snapshot has an adjacency list that is unsorted or has a loop or duplicate.");
+
+    // Every edge must appear in both lists.  Visiting the lists in order of v,
+    // each w's list is consumed from the front, so the next unmatched entry of
+    // w's list must be v.  Each entry is matched at most once and there are as
+    // many matches as entries, so then every entry has its partner.
+    vector<uint64_t> next_unmatched(offsets, offsets + n);
+    for (v=0; v<n; v++) {
+        for (uint64_t j=offsets[v]; j<offsets[v + 1]; j++) {
+            int w = neighbours[j];
+            if (next_unmatched[w] == offsets[w + 1] || uint64_t(neighbours[next_unmatched[w]]) != v)
+                fail("The CSR snapshot's adjacency lists are not symmetric.");
+            ++next_unmatched[w];
+        }
+    }
+}
+
+// Write an array, padded with zeros to a multiple of 8 bytes, and add it to the
+// checksum
+template<typename T>
+static auto write_array(FILE * f, vector<T> & array, uint64_t & checksum) -> void
+{
+    uint64_t num_bytes = array.size() * sizeof(T);
+    array.resize(padded(num_bytes) / sizeof(T));
+    if (fwrite(array.data(), sizeof(T), array.size(), f) != array.size())
+        fail("Error writing the CSR snapshot.");
+    checksum = update_checksum(checksum, array.data(), array.size() * sizeof(T));
+}
+
+auto write_csr_snapshot(const SparseGraph & g, const char * filename) -> void
+{
+    vector<uint64_t> offsets(g.n + 1);
+    for (unsigned v=0; v<g.n; v++)
+        offsets[v + 1] = offsets[v] + g.degree(v);
+
+    CsrSnapshotHeader header;
+    memcpy(header.magic, CSR_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = CSR_SNAPSHOT_VERSION;
+    header.byte_order_mark = CSR_SNAPSHOT_BYTE_ORDER_MARK;
+    header.n = g.n;
+    header.num_adj_entries = offsets[g.n];
+
+    FILE * f = fopen(filename, "wb");
+    if (!f)
+        fail("Could not open the CSR snapshot file for writing.");
+
+    // the checksum is not known until the arrays have been written, so it is
+    // filled in afterwards
+    header.checksum = 0;
+    if (fwrite(&header, sizeof(header), 1, f) != 1)
+        fail("Error writing the CSR snapshot.");
+
+    uint64_t checksum = CHECKSUM_SEED;
+    write_array(f, offsets, checksum);
+    {
+        vector<int32_t> neighbours;
+        neighbours.reserve(header.num_adj_entries + 1);
+        for (unsigned v=0; v<g.n; v++)
+            for (int w : g.neighbours(v))
+                neighbours.push_back(w);
+        write_array(f, neighbours, checksum);
+    }
+    vector<int64_t> weights(g.weight.begin(), g.weight.end());
+    write_array(f, weights, checksum);
+    vector<uint8_t> has_loop(g.vertex_has_loop.begin(), g.vertex_has_loop.end());
+    write_array(f, has_loop, checksum);
+
+    header.checksum = checksum;
+    if (fseek(f, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, f) != 1 || fclose(f) != 0)
+        fail("Error writing the CSR snapshot.");
+}
@@ -0,0 +1,68 @@
+#ifndef CSR_SNAPSHOT_H
+#define CSR_SNAPSHOT_H
+
+#include "input_buffer.h"
+
+#include <stdint.h>
+
+// A binary snapshot of a graph in compressed sparse row (CSR) form, so that
+// repeated runs on the same instance can skip parsing, sorting and
+// de-duplicating the text input.
+//
+// The file is a CsrSnapshotHeader followed by four arrays, each padded with
+// zeros to a multiple of 8 bytes:
+//
+//     uint64_t offsets[n + 1]               neighbours of v are at
+//                                           offsets[v] .. offsets[v+1]-1
+//     int32_t  neighbours[num_adj_entries]  sorted, without loops or duplicates
+//     int64_t  weights[n]
+//     uint8_t  has_loop[n]
+//
+// All numbers are in the byte order of the machine that wrote the file.  The
+// checksum covers everything after the header.
+
+#define CSR_SNAPSHOT_MAGIC "PEATYCSR"
+#define CSR_SNAPSHOT_VERSION 1
+#define CSR_SNAPSHOT_BYTE_ORDER_MARK 0x01020304u
+
+struct CsrSnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint64_t n;
+    uint64_t num_adj_entries;    // twice the number of edges
+    uint64_t checksum;
+};
+
+// A snapshot read from standard input.  A snapshot in a regular file is
+// memory-mapped and the arrays point into the mapping.  The kernelizer changes
+// the graph, so SparseGraph copies the neighbours array once, but nothing is
+// parsed or sorted.  The header, the checksum and the adjacency lists (sorted,
+// without loops or duplicates, and symmetric) are verified on loading; fail()
+// is called if any of them is wrong.
+class CsrSnapshot
+{
+    InputBuffer input;
+
+public:
+    unsigned n;
+    uint64_t num_adj_entries;
+    const uint64_t * offsets;
+    const int32_t * neighbours;
+    const int64_t * weights;
+    const uint8_t * has_loop;
+
+    CsrSnapshot();
+
+    CsrSnapshot(const CsrSnapshot &) = delete;
+    CsrSnapshot & operator=(const CsrSnapshot &) = delete;
+};
+
+struct SparseGraph;
+
+// Write g as a snapshot to the file called filename.  g's adjacency lists must
+// be sorted, as they are after reading a text file.
+auto write_csr_snapshot(const SparseGraph & g, const char * filename) -> void;
+
+#endif
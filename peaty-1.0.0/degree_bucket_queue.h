@@ -0,0 +1,82 @@
+#ifndef DEGREE_BUCKET_QUEUE_H
+#define DEGREE_BUCKET_QUEUE_H
+
+#include <vector>
+
+using std::vector;
+
+// A set of vertices, each filed in a bucket according to a key (normally its
+// degree).  Insertion, re-keying and removal are O(1), and pop() returns a
+// vertex with the smallest key.  The buckets are doubly-linked lists, laid out
+// as in initialise(): elements 0..n-1 are vertices and n+k is the list head
+// for key k.
+struct DegreeBucketQueue {
+    int n;
+    vector<int> ll_next;
+    vector<int> ll_prev;
+    vector<int> key;     // -1 if the vertex is not in the queue
+    int min_key;
+    int size;
+
+    DegreeBucketQueue(int capacity)
+            : n(capacity), ll_next(capacity * 2 + 1), ll_prev(capacity * 2 + 1),
+              key(capacity, -1), min_key(capacity), size(0)
+    {
+        for (int k=0; k<=n; k++) {
+            ll_next[n + k] = n + k;
+            ll_prev[n + k] = n + k;
+        }
+    }
+
+    auto contains(int v) -> bool
+    {
+        return key[v] != -1;
+    }
+
+    auto remove(int v) -> void
+    {
+        if (key[v] == -1)
+            return;
+        ll_next[ll_prev[v]] = ll_next[v];
+        ll_prev[ll_next[v]] = ll_prev[v];
+        key[v] = -1;
+        --size;
+    }
+
+    // Insert v with key k, or move it to bucket k if it is already present.
+    // Keys greater than n are clamped to n.
+    auto push(int v, int k) -> void
+    {
+        if (k > n)
+            k = n;
+        if (key[v] == k)
+            return;
+        remove(v);
+        int head = n + k;
+        ll_next[v] = ll_next[head];
+        ll_prev[v] = head;
+        ll_prev[ll_next[head]] = v;
+        ll_next[head] = v;
+        key[v] = k;
+        ++size;
+        if (k < min_key)
+            min_key = k;
+    }
+
+    auto empty() -> bool
+    {
+        return size == 0;
+    }
+
+    // Precondition: the queue is not empty
+    auto pop() -> int
+    {
+        while (ll_next[n + min_key] == n + min_key)
+            ++min_key;
+        int v = ll_next[n + min_key];
+        remove(v);
+        return v;
+    }
+};
+
+#endif
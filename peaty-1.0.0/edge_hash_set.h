@@ -0,0 +1,127 @@
+#ifndef EDGE_HASH_SET_H
+#define EDGE_HASH_SET_H
+
+#include <algorithm>
+#include <vector>
+
+using std::vector;
+
+// An open-addressing (linear probing) hash set of undirected edges, each
+// packed into a 64-bit key with the smaller endpoint in the high half.
+// Deleted slots are marked with a tombstone; the table is rebuilt when
+// occupied slots, including tombstones, exceed half of its capacity.
+struct EdgeHashSet {
+    enum : unsigned long long { EMPTY = ~0ull, TOMBSTONE = ~0ull - 1 };
+
+    vector<unsigned long long> slots;
+    unsigned long long mask;
+    int shift;
+    int size;
+    int num_occupied;    // size plus the number of tombstones
+
+    EdgeHashSet() : slots(2, EMPTY), mask(1), shift(63), size(0), num_occupied(0)
+    {
+    }
+
+    static auto make_key(int v, int w) -> unsigned long long
+    {
+        if (v > w)
+            std::swap(v, w);
+        return ((unsigned long long) v << 32) | (unsigned) w;
+    }
+
+    auto home_slot(unsigned long long key) const -> unsigned long long
+    {
+        // Fibonacci hashing; the high bits of the product are best mixed
+        return (key * 0x9E3779B97F4A7C15ull) >> shift;
+    }
+
+    auto clear() -> void
+    {
+        std::fill(slots.begin(), slots.end(), EMPTY);
+        size = 0;
+        num_occupied = 0;
+    }
+
+    // Make room for at least `capacity` edges without rehashing
+    auto reserve(int capacity) -> void
+    {
+        unsigned long long num_slots = 2;
+        while (num_slots < 2ull * capacity + 2)
+            num_slots *= 2;
+        if (num_slots <= slots.size())
+            return;
+        rehash(num_slots);
+    }
+
+    auto rehash(unsigned long long num_slots) -> void
+    {
+        vector<unsigned long long> old_slots(num_slots, EMPTY);
+        old_slots.swap(slots);
+        mask = num_slots - 1;
+        shift = 64 - __builtin_ctzll(num_slots);
+        size = 0;
+        num_occupied = 0;
+        for (unsigned long long key : old_slots)
+            if (key != EMPTY && key != TOMBSTONE)
+                insert_key(key);
+    }
+
+    auto contains(int v, int w) const -> bool
+    {
+        unsigned long long key = make_key(v, w);
+        for (unsigned long long i = home_slot(key); ; i = (i + 1) & mask) {
+            if (slots[i] == key)
+                return true;
+            if (slots[i] == EMPTY)
+                return false;
+        }
+    }
+
+    // Return whether the edge was absent before the call
+    auto insert(int v, int w) -> bool
+    {
+        if (2ull * (num_occupied + 1) > slots.size())
+            rehash(size * 4ull + 4 > slots.size() ? slots.size() * 2 : slots.size());
+        return insert_key(make_key(v, w));
+    }
+
+    // Return whether the edge was present before the call
+    auto erase(int v, int w) -> bool
+    {
+        unsigned long long key = make_key(v, w);
+        for (unsigned long long i = home_slot(key); ; i = (i + 1) & mask) {
+            if (slots[i] == key) {
+                slots[i] = TOMBSTONE;
+                --size;
+                return true;
+            }
+            if (slots[i] == EMPTY)
+                return false;
+        }
+    }
+
+private:
+    auto insert_key(unsigned long long key) -> bool
+    {
+        long long first_tombstone = -1;
+        for (unsigned long long i = home_slot(key); ; i = (i + 1) & mask) {
+            if (slots[i] == key)
+                return false;
+            if (slots[i] == TOMBSTONE && first_tombstone == -1) {
+                first_tombstone = i;
+            } else if (slots[i] == EMPTY) {
+                if (first_tombstone != -1) {
+                    slots[first_tombstone] = key;
+                } else {
+                    slots[i] = key;
+                    ++num_occupied;
+                }
+                ++size;
+                return true;
+            }
+        }
+    }
+};
+
+#endif
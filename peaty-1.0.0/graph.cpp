@@ -10,15 +10,33 @@
 
 Graph::Graph(int n)
         : n(n), numwords((n+BITS_PER_WORD-1)/BITS_PER_WORD), weight(n),
-          bit_complement_nd(n, vector<unsigned long long>(numwords, ~0ull))
+          bit_complement_nd(n, numwords)
+{
+    remove_all_edges();
+}
+
+// The bit matrix starts with all bits zero, which represents a complete graph
+Graph::Graph(int n, Complete)
+        : n(n), numwords((n+BITS_PER_WORD-1)/BITS_PER_WORD), weight(n),
+          bit_complement_nd(n, numwords)
+{
+}
+
+auto Graph::complete_graph(int n) -> Graph
+{
+    return Graph(n, Complete());
+}
+
+// Set every bit of the first n columns of the bit matrix, except the diagonal
+auto Graph::remove_all_edges() -> void
 {
-    if (0 != n % BITS_PER_WORD) {
-        for (int i=0; i<n; i++) {
-            bit_complement_nd[i].back() = (1ull << (n % BITS_PER_WORD)) - 1;
-        }
-    }
     for (int i=0; i<n; i++) {
-        unset_bit(bit_complement_nd[i], i);
+        unsigned long long * row = bit_complement_nd[i];
+        for (int j=0; j<numwords; j++)
+            row[j] = ~0ull;
+        if (0 != n % BITS_PER_WORD)
+            row[numwords - 1] = (1ull << (n % BITS_PER_WORD)) - 1;
+        UNSET_BIT(row, i);
     }
 }
 
@@ -27,31 +45,18 @@ auto Graph::resize(unsigned new_n) -> void
     n = new_n;
     numwords = ((n+BITS_PER_WORD-1)/BITS_PER_WORD);
     weight.resize(n);
-    bit_complement_nd.resize(n);
-
-    for (auto & bcn : bit_complement_nd) {
-        bcn.assign(numwords, ~0ull);
-    }
-
-    if (0 != n % BITS_PER_WORD) {
-        for (int i=0; i<n; i++) {
-            bit_complement_nd[i].back() = (1ull << (n % BITS_PER_WORD)) - 1;
-        }
-    }
-    for (int i=0; i<n; i++) {
-        unset_bit(bit_complement_nd[i], i);
-    }
+    bit_complement_nd.resize(n, numwords);
+    remove_all_edges();
 }
 
 Graph induced_subgraph(const Graph & g, const vector<int> vv) {
     struct Graph subg(vv.size());
     for (int i=0; i<subg.n; i++) {
-        auto & row = g.bit_complement_nd[vv[i]];
+        auto row = g.bit_complement_nd[vv[i]];
         for (int j=i+1; j<subg.n; j++) {
             bool bit = test_bit(row, vv[j]);
             if (!bit) {
-                unset_bit(subg.bit_complement_nd[i], j);
-                unset_bit(subg.bit_complement_nd[j], i);
+                subg.add_edge(i, j);
             }
         }
     }
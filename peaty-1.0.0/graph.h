@@ -1,6 +1,8 @@
 #ifndef GRAPH_H
 #define GRAPH_H
 
+#include "bit_matrix.h"
+
 #include <limits.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -20,9 +22,12 @@ struct Graph
     int n;
     int numwords;
     vector<long> weight;
-    std::vector<std::vector<unsigned long long>> bit_complement_nd;
+    BitMatrix bit_complement_nd;
 
+    // An edgeless graph
     Graph(int n);
+
+    static auto complete_graph(int n) -> Graph;
     auto add_edge(int v, int w) -> void
     {
         UNSET_BIT(bit_complement_nd[v], w);
@@ -36,6 +41,12 @@ struct Graph
     }
 
     auto resize(unsigned new_n) -> void;
+
+private:
+    struct Complete {};
+    Graph(int n, Complete);
+
+    auto remove_all_edges() -> void;
 };
 
 struct VtxList {
@@ -9,25 +9,26 @@
 #include <string.h>
 #include <time.h>
 
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <utility>
+
 ////////////////////////////////////////////////////////////////////////////////
 //                                GRAPH STUFF                                 //
 ////////////////////////////////////////////////////////////////////////////////
 
-void ColouringGraph::make_adjacency_lists()
+ColouringGraph ColouringGraph::induced_subgraph(const std::vector<int> & vv) const
 {
-    for (int i=0; i<n; i++)
-        for (int j=0; j<n; j++)
-            if (adj_matrix[i][j])
-                adjlist[i].push_back(j);
-}
+    std::vector<int> old_to_new_vtx(n, -1);
+    for (unsigned i=0; i<vv.size(); i++)
+        old_to_new_vtx[vv[i]] = i;
 
-ColouringGraph ColouringGraph::induced_subgraph(std::vector<int> & vv) const
-{
     ColouringGraph subg(vv.size());
     for (int i=0; i<subg.n; i++)
-        for (int j=0; j<i; j++)
-            if (adj_matrix[vv[i]][vv[j]])
-                subg.add_edge(i, j);
+        for (int w : adjlist[vv[i]])
+            if (old_to_new_vtx[w] != -1 && old_to_new_vtx[w] < i)
+                subg.add_edge(i, old_to_new_vtx[w]);
 
     return subg;
 }
@@ -39,11 +40,16 @@ ColouringGraph ColouringGraph::induced_subgraph(std::vector<int> & vv) const
 #define BYTES_PER_WORD sizeof(unsigned long long)
 #define BITS_PER_WORD (CHAR_BIT * BYTES_PER_WORD)
 
-static bool test_bit(unsigned long long *bitset, int bit)
+static bool test_bit(const unsigned long long *bitset, int bit)
 {
     return 0 != (bitset[bit/BITS_PER_WORD] & (1ull << (bit%BITS_PER_WORD)));
 }
 
+static void set_bit(unsigned long long *bitset, int bit)
+{
+    bitset[bit/BITS_PER_WORD] |= (1ull << (bit%BITS_PER_WORD));
+}
+
 static void set_first_n_bits(unsigned long long *bitset, int n)
 {
     for (int bit=0; bit<n; bit++)
@@ -55,15 +61,8 @@ static void unset_bit(unsigned long long *bitset, int bit)
     bitset[bit/BITS_PER_WORD] &= ~(1ull << (bit%BITS_PER_WORD));
 }
 
-static int bitset_popcount(unsigned long long *bitset, int num_words)
-{
-    int count = 0;
-    for (int i=num_words-1; i>=0; i--)
-        count += __builtin_popcountll(bitset[i]);
-    return count;
-}
-
-static int bitset_intersection_popcount(unsigned long long *bitset1, unsigned long long *bitset2, int num_words)
+static int bitset_intersection_popcount(const unsigned long long *bitset1, const unsigned long long *bitset2,
+        int num_words)
 {
     int count = 0;
     for (int i=num_words-1; i>=0; i--)
@@ -71,13 +70,13 @@ static int bitset_intersection_popcount(unsigned long long *bitset1, unsigned lo
     return count;
 }
 
-static void bitset_intersect_with(unsigned long long *bitset1, unsigned long long *bitset2, int num_words)
+static void bitset_intersect_with(unsigned long long *bitset1, const unsigned long long *bitset2, int num_words)
 {
     for (int i=num_words-1; i>=0; i--)
         bitset1[i] &= bitset2[i];
 }
 
-static bool bitset_empty(unsigned long long *bitset, int num_words)
+static bool bitset_empty(const unsigned long long *bitset, int num_words)
 {
     for (int i=num_words-1; i>=0; i--)
         if (bitset[i])
@@ -85,13 +84,7 @@ static bool bitset_empty(unsigned long long *bitset, int num_words)
     return true;
 }
 
-static void clear_bitset(unsigned long long *bitset, int num_words)
-{
-    for (int i=num_words-1; i>=0; i--)
-        bitset[i] = 0ull;
-}
-
-static int first_set_bit(unsigned long long *bitset,
+static int first_set_bit(const unsigned long long *bitset,
                          int num_words)
 {
     for (int i=0; i<num_words; i++)
@@ -100,309 +93,352 @@ static int first_set_bit(unsigned long long *bitset,
     return -1;
 }
 
-static void copy_bitset(unsigned long long *src,
-                        unsigned long long *dest,
-                        int num_words)
-{
-    for (int i=0; i<num_words; i++)
-        dest[i] = src[i];
-}
-
 ////////////////////////////////////////////////////////////////////////////////
-//                               SOLUTION STUFF                               //
+//                                THE SEARCH                                  //
 ////////////////////////////////////////////////////////////////////////////////
 
-void solution_colour_vtx(struct Solution *solution, int v, int colour,
-        unsigned long long *available_classes_bitset, int *num_colours_assigned_to_vertex, int domain_num_words, int f)
+// A search for an f-fold clique cover of g with num_colours cliques.  Each
+// vertex must receive f distinct colours, and two vertices that share a
+// colour must be adjacent.
+//
+// The domain of each vertex is stored twice: as a bitset of the colours that
+// it can still take, and in the bitset of vertices that can still take each
+// colour, so that a colour can be removed from all non-neighbours of a
+// vertex a word at a time.  Every removal is recorded on a trail, and
+// backtracking undoes removals rather than restoring a copy of the domains.
+class ColouringSearch
 {
-    ++solution->size;
-    solution->vtx_colour[v][num_colours_assigned_to_vertex[v]] = colour;
-    ++num_colours_assigned_to_vertex[v];
-    unset_bit(available_classes_bitset + v * domain_num_words, colour);
-    if (num_colours_assigned_to_vertex[v] == f)
-        clear_bitset(available_classes_bitset + v * domain_num_words, domain_num_words);
-}
+    const ColouringGraph & g;
+    int num_colours;
+    int f;
+    int domain_num_words;
 
-void solution_pop_vtx(struct Solution *solution)
-{
-    solution->size--;
-}
+    std::vector<unsigned long long> domains;                  // n * domain_num_words
+    std::vector<unsigned long long> vertices_with_colour;     // num_colours * g.numwords
+    std::vector<int> domain_size;
+    std::vector<int> num_colours_assigned_to_vertex;
+    int num_assignments;
 
-void solution_resize(struct Solution *solution, int size)
-{
-    solution->size = size;
-}
+    std::vector<std::pair<int, int>> removal_trail;    // (vertex, colour)
+    std::vector<int> assignment_trail;
 
-void copy_Solution(struct Solution *src, struct Solution *dest)
-{
-    dest->size = src->size;
-    dest->vtx_colour = src->vtx_colour;
-}
+    // vertices whose remaining colours must all be used
+    std::vector<int> unit_vv;
 
-////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////
-
-// Precondition: at least one vertex remains that can be branched on.
-int choose_branching_vertex(ColouringGraph *g, unsigned long long *available_classes_bitset,
-        int domain_num_words)
-{
-    int best_available_class_count = INT_MAX;
+    // scratch space for choose_branching_vertex()
     std::vector<int> vertices_with_best_available_class_count;
-    for (int i=0; i<g->n; i++) {
-        if (bitset_empty(available_classes_bitset + i * domain_num_words, domain_num_words))
-            continue;
-        int available_class_count = bitset_popcount(available_classes_bitset + i * domain_num_words, domain_num_words);
-        if (available_class_count < best_available_class_count) {
-            best_available_class_count = available_class_count;
-            vertices_with_best_available_class_count.clear();
-        }
-        if (available_class_count == best_available_class_count)
-            vertices_with_best_available_class_count.push_back(i);
-    }
+    std::vector<int> scores;
 
-    std::vector<int> scores(vertices_with_best_available_class_count.size());
-
-    for (unsigned i=0; i<vertices_with_best_available_class_count.size(); i++) {
-        int v = vertices_with_best_available_class_count[i];
-        for (unsigned j=0; j<i; j++) {
-            int w = vertices_with_best_available_class_count[j];
-            if (!g->adj_matrix[v][w]) {
-                int pc = bitset_intersection_popcount(
-                        available_classes_bitset + v * domain_num_words, available_classes_bitset + w * domain_num_words,
-                        domain_num_words);
-                scores[i] += pc;
-                scores[j] += pc;
-            }
-        }
+    unsigned long long & expand_call_count;
+    unsigned long long expand_call_limit;
+    std::atomic_bool & terminate_early;
+    const std::atomic_bool & stop;
+    bool found;
+
+    unsigned long long * domain(int v)
+    {
+        return domains.data() + v * domain_num_words;
     }
 
-    int best_v = -1;
-    int best_score = -1;
-    for (unsigned i=0; i<vertices_with_best_available_class_count.size(); i++) {
-        int v = vertices_with_best_available_class_count[i];
-        if (scores[i] > best_score) {
-            best_score = scores[i];
-            best_v = v;
-        }
+    void unchecked_remove(int v, int colour)
+    {
+        unset_bit(domain(v), colour);
+        unset_bit(vertices_with_colour.data() + colour * g.numwords, v);
+        --domain_size[v];
+        removal_trail.push_back({v, colour});
     }
 
-    return best_v;
-}
+    // Remove colour from v's domain, and return false on a domain wipeout
+    bool remove(int v, int colour)
+    {
+        unchecked_remove(v, colour);
+        int num_possible_colours = domain_size[v] + num_colours_assigned_to_vertex[v];
+        if (num_possible_colours < f)
+            return false;
+        if (domain_size[v] != 0 && num_possible_colours == f)
+            unit_vv.push_back(v);
+        return true;
+    }
 
-void expand(ColouringGraph *g, struct Solution *C,
-        struct Solution *incumbent, int level, unsigned long long *expand_call_count, unsigned long long expand_call_limit,
-        int num_colours, unsigned long long *available_classes_bitset,
-        int *num_colours_assigned_to_vertex, int domain_num_words, int f, std::atomic_bool & terminate_early)
-{
-    (*expand_call_count)++;
-    if (*expand_call_count >= expand_call_limit)
-        return;
+    // Give v the colour, and remove the colour from the domains of v's
+    // non-neighbours.  Return false on a domain wipeout.
+    bool assign(int v, int colour)
+    {
+        unchecked_remove(v, colour);
+        ++num_colours_assigned_to_vertex[v];
+        ++num_assignments;
+        assignment_trail.push_back(v);
+        if (num_colours_assigned_to_vertex[v] == f) {
+            int c;
+            while ((c = first_set_bit(domain(v), domain_num_words)) != -1)
+                unchecked_remove(v, c);
+        }
 
-    if (terminate_early.load())
-        return;
+        const unsigned long long * adj_row = g.adj_row(v);
+        unsigned long long * can_take_colour = vertices_with_colour.data() + colour * g.numwords;
+        for (int i=0; i<g.numwords; i++) {
+            unsigned long long word = can_take_colour[i] & ~adj_row[i];
+            while (word) {
+                int bit = __builtin_ctzll(word);
+                word ^= (1ull << bit);
+                if (!remove(i*BITS_PER_WORD + bit, colour))
+                    return false;
+            }
+        }
+        return true;
+    }
 
-    if (C->size == g->n * f) {
-        copy_Solution(C, incumbent);
-        return;
+    bool propagate()
+    {
+        while (!unit_vv.empty()) {
+            int v = unit_vv.back();
+            unit_vv.pop_back();
+            if (domain_size[v] == 0)
+                continue;
+            if (!assign(v, first_set_bit(domain(v), domain_num_words)))
+                return false;
+            if (domain_size[v] != 0)
+                unit_vv.push_back(v);
+        }
+        return true;
     }
 
-    // UNIT PROPAGATION
-    int C_sz_before_unit_prop = C->size;
-    std::vector<int> unit_v_stack;
-    for (int i=0; i<g->n; i++) {
-        int pc = bitset_popcount(available_classes_bitset + i * domain_num_words, domain_num_words);
-        int num_possible_colours = pc + num_colours_assigned_to_vertex[i];
-        if (pc != 0 && num_possible_colours == f) {
-            unit_v_stack.push_back(i);
-        } else if (num_possible_colours < f) {
-            return;
+    void undo(unsigned removal_trail_size, unsigned assignment_trail_size)
+    {
+        while (removal_trail.size() > removal_trail_size) {
+            int v = removal_trail.back().first;
+            int colour = removal_trail.back().second;
+            removal_trail.pop_back();
+            set_bit(domain(v), colour);
+            set_bit(vertices_with_colour.data() + colour * g.numwords, v);
+            ++domain_size[v];
+        }
+        while (assignment_trail.size() > assignment_trail_size) {
+            --num_colours_assigned_to_vertex[assignment_trail.back()];
+            --num_assignments;
+            assignment_trail.pop_back();
         }
+        unit_vv.clear();
     }
 
-    while (!unit_v_stack.empty()) {
-        int v = unit_v_stack.back();
-        unit_v_stack.pop_back();
-        int colour = first_set_bit(available_classes_bitset + v * domain_num_words, domain_num_words);
-        solution_colour_vtx(C, v, colour, available_classes_bitset, num_colours_assigned_to_vertex, domain_num_words, f);
-        if (num_colours_assigned_to_vertex[v] != f)
-            unit_v_stack.push_back(v);
-
-        unsigned i=0;
-        for (int w=0; w<g->n; w++) {
-            if (i < g->adjlist[v].size() && g->adjlist[v][i] == w) {
-                ++i;
-                continue;
-            } else if (w == v) {
+    // Choose a vertex with the smallest non-empty domain, breaking ties by
+    // the number of colours that it shares with the other candidates that it
+    // could share a colour with.
+    // Precondition: at least one vertex remains that can be branched on.
+    int choose_branching_vertex()
+    {
+        int best_available_class_count = INT_MAX;
+        vertices_with_best_available_class_count.clear();
+        for (int i=0; i<g.n; i++) {
+            int available_class_count = domain_size[i];
+            if (available_class_count == 0)
                 continue;
+            if (available_class_count < best_available_class_count) {
+                best_available_class_count = available_class_count;
+                vertices_with_best_available_class_count.clear();
             }
-            if (test_bit(available_classes_bitset + w * domain_num_words, colour)) {
-                unset_bit(available_classes_bitset + w * domain_num_words, colour);
-                int popcount = bitset_popcount(available_classes_bitset + w * domain_num_words, domain_num_words);
-                if (popcount != 0 && popcount + num_colours_assigned_to_vertex[w] == f) {
-                    unit_v_stack.push_back(w);
-                } else if (popcount + num_colours_assigned_to_vertex[w] < f) {
-                    solution_resize(C, C_sz_before_unit_prop);
-                    return;
+            if (available_class_count == best_available_class_count)
+                vertices_with_best_available_class_count.push_back(i);
+        }
+
+        auto & candidates = vertices_with_best_available_class_count;
+        scores.assign(candidates.size(), 0);
+        for (unsigned i=0; i<candidates.size(); i++) {
+            int v = candidates[i];
+            for (unsigned j=0; j<i; j++) {
+                int w = candidates[j];
+                if (!g.has_edge(v, w)) {
+                    int pc = bitset_intersection_popcount(domain(v), domain(w), domain_num_words);
+                    scores[i] += pc;
+                    scores[j] += pc;
                 }
             }
         }
-    }
 
-    if (C->size == g->n * f) {
-        copy_Solution(C, incumbent);
-        solution_resize(C, C_sz_before_unit_prop);
-        return;
+        int best_v = -1;
+        int best_score = -1;
+        for (unsigned i=0; i<candidates.size(); i++) {
+            if (scores[i] > best_score) {
+                best_score = scores[i];
+                best_v = candidates[i];
+            }
+        }
+
+        return best_v;
     }
 
-    int best_v = choose_branching_vertex(g, available_classes_bitset, domain_num_words);
-
-    std::vector<unsigned long long> colours_in_all_domains(domain_num_words, ~0ull);
-    for (int i=0; i<g->n; i++)
-        if (!bitset_empty(available_classes_bitset + i * domain_num_words, domain_num_words))
-            bitset_intersect_with(colours_in_all_domains.data(), available_classes_bitset + i * domain_num_words, domain_num_words);
-
-    std::vector<unsigned long long> domain_copy(domain_num_words);
-    copy_bitset(available_classes_bitset + best_v * domain_num_words, domain_copy.data(), domain_num_words);
-
-    std::vector<unsigned long long> new_available_classes_bitset(g->n * domain_num_words);
-    std::vector<int> new_num_colours_assigned_to_vertex(g->n);
-
-    bool colour_is_in_all_domains;
-    do {
-        int colour = first_set_bit(domain_copy.data(), domain_num_words);
-        unset_bit(domain_copy.data(), colour);
-        colour_is_in_all_domains = test_bit(colours_in_all_domains.data(), colour);
-        
-        for (int i=0; i<g->n; i++)
-            new_num_colours_assigned_to_vertex[i] = num_colours_assigned_to_vertex[i];
-        for (int i=0; i<g->n * domain_num_words; i++)
-            new_available_classes_bitset[i] = available_classes_bitset[i];
-
-        unsigned i=0;
-        for (int w=0; w<g->n; w++) {
-            if (i < g->adjlist[best_v].size() && g->adjlist[best_v][i] == w) {
-                ++i;
-                continue;
-            } else if (w == best_v) {
-                continue;
-            }
-            unset_bit(new_available_classes_bitset.data() + w * domain_num_words, colour);
-            // We don't need to check for domain wipeout here, since any domain that was unit
-            // would have been instantiated in the unit-propagation step.
+    void expand()
+    {
+        expand_call_count++;
+        if (expand_call_count >= expand_call_limit)
+            return;
+
+        if (terminate_early.load() || stop.load())
+            return;
+
+        if (num_assignments == g.n * f) {
+            found = true;
+            return;
         }
 
-        solution_colour_vtx(C, best_v, colour, new_available_classes_bitset.data(), new_num_colours_assigned_to_vertex.data(), domain_num_words, f);
-        expand(g, C, incumbent, level+1, expand_call_count, expand_call_limit,
-                num_colours, new_available_classes_bitset.data(), new_num_colours_assigned_to_vertex.data(), domain_num_words, f, terminate_early);
-        solution_pop_vtx(C);
-    } while (incumbent->size < g->n * f &&
-             !colour_is_in_all_domains  &&
-             !bitset_empty(domain_copy.data(), domain_num_words));
+        int best_v = choose_branching_vertex();
+
+        // Colours that no vertex has lost yet are interchangeable, so only
+        // the first of them needs to be tried
+        std::vector<unsigned long long> colours_in_all_domains(domain_num_words, ~0ull);
+        for (int i=0; i<g.n; i++)
+            if (domain_size[i] != 0)
+                bitset_intersect_with(colours_in_all_domains.data(), domain(i), domain_num_words);
+
+        std::vector<unsigned long long> domain_copy(domain(best_v), domain(best_v) + domain_num_words);
+
+        unsigned removal_trail_size = removal_trail.size();
+        unsigned assignment_trail_size = assignment_trail.size();
+        bool colour_is_in_all_domains;
+        do {
+            int colour = first_set_bit(domain_copy.data(), domain_num_words);
+            unset_bit(domain_copy.data(), colour);
+            colour_is_in_all_domains = test_bit(colours_in_all_domains.data(), colour);
+
+            if (assign(best_v, colour) && propagate())
+                expand();
+            undo(removal_trail_size, assignment_trail_size);
+        } while (!found &&
+                 !colour_is_in_all_domains &&
+                 !bitset_empty(domain_copy.data(), domain_num_words));
+    }
 
-    solution_resize(C, C_sz_before_unit_prop);
-}
+public:
+    ColouringSearch(const ColouringGraph & g, int num_colours, int f, unsigned long long & expand_call_count,
+            unsigned long long expand_call_limit, std::atomic_bool & terminate_early, const std::atomic_bool & stop)
+            : g(g), num_colours(num_colours), f(f), domain_num_words((num_colours + BITS_PER_WORD - 1) / BITS_PER_WORD),
+              domains(g.n * domain_num_words), vertices_with_colour(num_colours * g.numwords),
+              domain_size(g.n, num_colours), num_colours_assigned_to_vertex(g.n), num_assignments(0),
+              expand_call_count(expand_call_count), expand_call_limit(expand_call_limit),
+              terminate_early(terminate_early), stop(stop), found(false)
+    {
+        for (int i=0; i<g.n; i++)
+            set_first_n_bits(domain(i), num_colours);
+        for (int c=0; c<num_colours; c++)
+            set_first_n_bits(vertices_with_colour.data() + c * g.numwords, g.n);
+    }
 
-void solve(ColouringGraph *g, unsigned long long *expand_call_count, unsigned long long expand_call_limit,
-        struct Solution *incumbent, int num_colours, int f, std::atomic_bool & terminate_early)
-{
-    struct Solution C(g->n, f);
-    int domain_num_words = (num_colours + BITS_PER_WORD - 1) / BITS_PER_WORD;
-    std::vector<unsigned long long> available_classes_bitset(g->n * domain_num_words);
-    for (int i=0; i<g->n; i++) {
-        set_first_n_bits(available_classes_bitset.data() + i * domain_num_words, num_colours);
+    // Return true if a clique cover was found
+    bool run()
+    {
+        if (g.n == 0)
+            return true;
+        if (num_colours < f)
+            return false;
+        if (num_colours == f)
+            for (int i=0; i<g.n; i++)
+                unit_vv.push_back(i);
+        if (propagate())
+            expand();
+        return found;
     }
-    std::vector<int> num_colours_assigned_to_vertex(g->n);
-    expand(g, &C, incumbent, 0, expand_call_count, expand_call_limit,
-            num_colours, available_classes_bitset.data(), num_colours_assigned_to_vertex.data(), domain_num_words, f, terminate_early);
-}
+};
 
-// FIXME
-bool is_solution_valid(ColouringGraph *g, struct Solution *solution,
-        int num_colours, int f)
+// The search gives up if either terminate_early or stop is set
+static bool solve(const ColouringGraph & g, unsigned long long & expand_call_count,
+        unsigned long long expand_call_limit, int num_colours, int f, std::atomic_bool & terminate_early,
+        const std::atomic_bool & stop)
 {
-    for (int i=0; i<g->n; i++)
-        for (int j=0; j<i; j++)
-            if (g->adj_matrix[i][j])
-                for (int k=0; k<f; k++)
-                    for (int m=0; m<f; m++)
-                        if (solution->vtx_colour[i][k] == solution->vtx_colour[j][m])
-                            return false;
-    for (int i=0; i<g->n; i++)
-        for (int j=0; j<f; j++)
-            if (solution->vtx_colour[i][j] < 0 || solution->vtx_colour[i][j] >= num_colours)
-                return false;
-    return true;
+    return ColouringSearch(g, num_colours, f, expand_call_count, expand_call_limit, terminate_early, stop).run();
 }
 
+// Uses its own generator rather than rand(), since several solvers may run
+// in parallel
 std::vector<int> randomised_vertex_order(const ColouringGraph & g, unsigned seed)
 {
-    srand(seed);
+    std::mt19937 rng(seed);
 
     std::vector<int> vv;
     for (int i=0; i<g.n; i++)
         vv.push_back(i);
     for (int i=g.n-1; i>=1; i--) {
-        int r = rand() % (i+1);
+        int r = rng() % (i+1);
         std::swap(vv[i], vv[r]);
     }
 
     return vv;
 }
 
-int find_colouring_number(const ColouringGraph & g, int f, std::atomic_bool & terminate_early)
+// One sequence of restarts.  Restart k uses seed first_seed + k * seed_step,
+// and has a node limit 10% higher than restart k-1.  The seed and the limit
+// carry over from one number of colours to the next.
+struct RestartSequence
 {
-    unsigned rng_seed = 0;
-
-    std::vector<int> vv = randomised_vertex_order(g, rng_seed);
-    ColouringGraph sorted_g = g.induced_subgraph(vv);
-
+    unsigned rng_seed;
+    unsigned seed_step;
     unsigned long long expand_call_limit = 1000;
-    int num_colours = 0;
-    for ( ; ; num_colours++) {
-        struct Solution clq(g.n, f);
 
-        sorted_g.make_adjacency_lists();
+    ColouringGraph sorted_g;
+    unsigned sorted_graph_seed;
 
-        unsigned long long expand_call_count = 0;
-        while (true) {
-            if (terminate_early.load())
-                return -1;
+    RestartSequence(const ColouringGraph & g, unsigned first_seed, unsigned seed_step)
+            : rng_seed(first_seed), seed_step(seed_step),
+              sorted_g(g.induced_subgraph(randomised_vertex_order(g, first_seed))), sorted_graph_seed(first_seed)
+    {
+    }
 
-            solve(&sorted_g, &expand_call_count, expand_call_limit, &clq, num_colours, f, terminate_early);
-            if (expand_call_count < expand_call_limit)
+    // Restart until a search finishes within its node limit, and return 1 if
+    // it found a clique cover with num_colours cliques and 0 if it proved that
+    // there is none.  Return -1 if terminate_early or stop is set first.
+    int decide(const ColouringGraph & g, int num_colours, int f, std::atomic_bool & terminate_early,
+            const std::atomic_bool & stop)
+    {
+        while (!terminate_early.load() && !stop.load()) {
+            if (sorted_graph_seed != rng_seed) {
+                sorted_g = g.induced_subgraph(randomised_vertex_order(g, rng_seed));
+                sorted_graph_seed = rng_seed;
+            }
+            unsigned long long expand_call_count = 0;
+            bool found = solve(sorted_g, expand_call_count, expand_call_limit, num_colours, f,
+                    terminate_early, stop);
+            if (terminate_early.load() || stop.load())
                 break;
-            clq.size = 0;
+            if (expand_call_count < expand_call_limit)
+                return found;
             expand_call_limit = expand_call_limit + expand_call_limit / 10;
-            expand_call_count = 0;
-            ++rng_seed;
-            vv = randomised_vertex_order(g, rng_seed);
-            sorted_g = g.induced_subgraph(vv);
-            sorted_g.make_adjacency_lists();
+            rng_seed += seed_step;
         }
+        return -1;
+    }
+};
 
-//        if (clq.size == sorted_g->n * arguments.fractional_level) {
-//            printf("Solution");
-//            struct Solution solution_for_unsorted_graph;
-//            init_Solution(&solution_for_unsorted_graph, sorted_g->n);
-//            solution_for_unsorted_graph.size = clq.size;
-//            for (int i=0; i<sorted_g->n; i++) {
-//                solution_for_unsorted_graph.vtx_colour[vv[i]] = clq.vtx_colour[i];
-//            }
-//            if (!is_solution_valid(g, &solution_for_unsorted_graph, num_colours))
-//                fail("The solution that was found is not a colouring with the correct number of colours!!!");
-//            for (int i=0; i<sorted_g->n; i++) {
-//                printf(" %d", solution_for_unsorted_graph.vtx_colour[i]);
-//            }
-//            destroy_Solution(&solution_for_unsorted_graph);
-//            printf("\n");
-//        }
-
-//        printf("%d %lld %s\n", num_colours, expand_call_count, clq.size == sorted_g.n * f ? "SATISFIABLE" : "UNSAT");
-
-        if (clq.size == sorted_g.n * f)
-            break;
+int find_colouring_number(const ColouringGraph & g, int f, std::atomic_bool & terminate_early, int num_threads)
+{
+    num_threads = std::max(1, num_threads);
+
+    // Thread t tries seeds t, t + num_threads, t + 2 * num_threads, ...
+    std::vector<RestartSequence> sequences;
+    for (int t=0; t<num_threads; t++)
+        sequences.emplace_back(g, t, num_threads);
+
+    for (int num_colours=0; ; num_colours++) {
+        // The first thread to decide this number of colours sets decided,
+        // which stops the others
+        std::atomic_bool decided(false);
+        std::atomic<int> result(-1);
+        auto run_sequence = [&](int t) {
+            int r = sequences[t].decide(g, num_colours, f, terminate_early, decided);
+            if (r != -1 && !decided.exchange(true))
+                result = r;
+        };
+
+        std::vector<std::thread> threads;
+        for (int t=1; t<num_threads; t++)
+            threads.emplace_back(run_sequence, t);
+        run_sequence(0);
+        for (auto & thread : threads)
+            thread.join();
+
+        if (result == -1)
+            return -1;
+        if (result == 1)
+            return num_colours;
     }
-    return num_colours;
 }
 
 unsigned long long ColouringNumberFinder::get_search_node_count()
@@ -415,7 +451,7 @@ int ColouringNumberFinder::get_colouring_number()
     return colouring_number;
 }
 
-void ColouringNumberFinder::search() {
+void ColouringNumberFinder::search(const std::atomic_bool * stop) {
 #ifdef WITHOUT_COLOURING_UPPER_BOUND
     return;
 #endif
@@ -423,27 +459,27 @@ void ColouringNumberFinder::search() {
     if (colouring_number != -1)
         return;    // solution has been found already
 
-    std::atomic_bool terminate_early(false);
-
-    std::vector<int> vv = randomised_vertex_order(g, rng_seed);
-    ColouringGraph sorted_g = g.induced_subgraph(vv);
-    sorted_g.make_adjacency_lists();
+    if (sorted_graph_seed != rng_seed) {
+        sorted_graph = g.induced_subgraph(randomised_vertex_order(g, rng_seed));
+        sorted_graph_seed = rng_seed;
+    }
 
-    struct Solution clq(g.n, f);
+    std::atomic_bool terminate_early(false);
+    std::atomic_bool never_stop(false);
 
     unsigned long long local_search_node_count = 0;
 
-    solve(&sorted_g, &local_search_node_count, local_search_node_limit, &clq, current_target_num_colours, f, terminate_early);
+    bool found = solve(sorted_graph, local_search_node_count, local_search_node_limit, current_target_num_colours,
+            f, terminate_early, stop ? *stop : never_stop);
     search_node_count += local_search_node_count;
+    if (stop && stop->load())
+        return;
 
     if (local_search_node_count >= local_search_node_limit) {
         local_search_node_limit = local_search_node_limit + local_search_node_limit / 10;
         ++rng_seed;
-        vv = randomised_vertex_order(g, rng_seed);
-        sorted_g = g.induced_subgraph(vv);
-        sorted_g.make_adjacency_lists();
     } else {
-        if (clq.size == g.n * f) {
+        if (found) {
             colouring_number = current_target_num_colours;
         } else {
             ++current_target_num_colours;
@@ -452,9 +488,6 @@ void ColouringNumberFinder::search() {
 }
 
 ColouringNumberFinder::ColouringNumberFinder(const ColouringGraph & g, int f)
-        : g(g), sorted_graph(0), f(f)
+        : g(g), f(f), sorted_graph(g.induced_subgraph(randomised_vertex_order(g, 0))), sorted_graph_seed(0)
 {
-    std::vector<int> vv = randomised_vertex_order(g, rng_seed);
-    ColouringGraph sorted_g = g.induced_subgraph(vv);
-    sorted_g.make_adjacency_lists();
 }
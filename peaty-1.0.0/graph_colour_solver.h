@@ -4,45 +4,57 @@
 #include <atomic>
 #include <vector>
 
+// A graph whose adjacency matrix is stored as one packed bitset per vertex,
+// with adjacency lists alongside for building induced subgraphs in O(n+m)
 struct ColouringGraph {
     int n;
-    std::vector<std::vector<bool>> adj_matrix;
+    int numwords;
+    std::vector<unsigned long long> adj_matrix;    // row v is words v*numwords to v*numwords+numwords-1
     std::vector<std::vector<int>> adjlist;
 
-    ColouringGraph(int n) : n(n), adj_matrix(n, std::vector<bool>(n)), adjlist(n) {
+    ColouringGraph(int n) : n(n), numwords((n + 63) / 64), adj_matrix(n * numwords), adjlist(n) {
     }
 
-    void add_edge(int v, int w)
+    bool has_edge(int v, int w) const
     {
-        adj_matrix[v][w] = true;
-        adj_matrix[w][v] = true;
+        return 0 != (adj_matrix[v * numwords + w / 64] & (1ull << (w % 64)));
     }
 
-    struct ColouringGraph induced_subgraph(std::vector<int> & vv) const;
-
-    void make_adjacency_lists();
-};
+    void add_edge(int v, int w)
+    {
+        if (has_edge(v, w))
+            return;
+        adj_matrix[v * numwords + w / 64] |= 1ull << (w % 64);
+        adj_matrix[w * numwords + v / 64] |= 1ull << (v % 64);
+        adjlist[v].push_back(w);
+        adjlist[w].push_back(v);
+    }
 
+    const unsigned long long * adj_row(int v) const
+    {
+        return adj_matrix.data() + v * numwords;
+    }
 
-struct Solution {
-    int size = 0;
-    std::vector<std::vector<int>> vtx_colour;
-    Solution(int n, int f) : vtx_colour(n, std::vector<int>(f)) {}
+    // The subgraph induced by vv, in which vertex i is vv[i]
+    struct ColouringGraph induced_subgraph(const std::vector<int> & vv) const;
 };
 
+// Find the f-fold clique cover number of g by trying 0, 1, 2, ... cliques in
+// turn.  Each number of cliques is decided by a portfolio of num_threads
+// sequences of randomised restarts, one per thread; the first sequence to
+// decide it stops the others.  Return -1 if terminate_early is set before
+// the number is found.
+int find_colouring_number(const ColouringGraph & g, int f, std::atomic_bool & terminate_early, int num_threads = 1);
 
-//void solve(struct ColouringGraph *g, unsigned long long *expand_call_count, unsigned long long expand_call_limit,
-//        bool quiet, struct Solution *incumbent, int num_colours, int f);
-//
-//bool is_solution_valid(struct ColouringGraph *g, struct Solution *solution,
-//        int num_colours);
-
-int find_colouring_number(const ColouringGraph & g, int f, std::atomic_bool & terminate_early);
-
+// Finds the f-fold clique cover number of a graph (its complement's f-fold
+// colouring number) a little at a time.  Each call of search() tries to
+// cover the graph with current_target_num_colours cliques within a node
+// limit; if the attempt runs out of nodes, the next call restarts with a
+// different vertex order and a higher limit.  An attempt that is cut short
+// by *stop leaves the finder as it was.
 class ColouringNumberFinder
 {
     const ColouringGraph & g;
-    ColouringGraph sorted_graph;
     int f;
     int current_target_num_colours = 0;
     unsigned rng_seed = 0;
@@ -50,10 +62,15 @@ class ColouringNumberFinder
     unsigned long long local_search_node_limit = 1000;
     int colouring_number = -1;
 
+    // g with its vertices shuffled using sorted_graph_seed; rebuilt only when
+    // rng_seed changes
+    ColouringGraph sorted_graph;
+    unsigned sorted_graph_seed;
+
 public:
     unsigned long long get_search_node_count();
     int get_colouring_number();
-    void search();
+    void search(const std::atomic_bool * stop = nullptr);
     ColouringNumberFinder(const ColouringGraph & g, int f);
 };
 
@@ -0,0 +1,70 @@
+#ifndef INPUT_BUFFER_H
+#define INPUT_BUFFER_H
+
+#include "util.h"
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+using std::vector;
+
+#define READ_BLOCK_SIZE (1 << 20)
+
+// The bytes of standard input.  A regular file is memory-mapped; anything else,
+// such as a pipe, is read in large blocks.
+class InputBuffer
+{
+    const char * data;
+    size_t size;
+    bool is_mapped;
+    vector<char> storage;
+
+public:
+    InputBuffer() : data(nullptr), size(0), is_mapped(false)
+    {
+        struct stat st;
+        if (fstat(STDIN_FILENO, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+                lseek(STDIN_FILENO, 0, SEEK_CUR) == 0) {
+            void * p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, st.st_size, MADV_WILLNEED);
+                data = static_cast<const char *>(p);
+                size = st.st_size;
+                is_mapped = true;
+                return;
+            }
+        }
+
+        for (;;) {
+            size_t old_size = storage.size();
+            storage.resize(old_size + READ_BLOCK_SIZE);
+            ssize_t num_read = read(STDIN_FILENO, storage.data() + old_size, READ_BLOCK_SIZE);
+            if (num_read < 0 && errno != EINTR)
+                fail("Error reading the input.");
+            storage.resize(old_size + std::max(num_read, ssize_t(0)));
+            if (num_read == 0)
+                break;
+        }
+        data = storage.data();
+        size = storage.size();
+    }
+
+    InputBuffer(const InputBuffer &) = delete;
+    InputBuffer & operator=(const InputBuffer &) = delete;
+
+    ~InputBuffer()
+    {
+        if (is_mapped)
+            munmap(const_cast<char *>(data), size);
+    }
+
+    auto begin() const -> const char * { return data; }
+    auto end() const -> const char * { return data + size; }
+};
+
+#endif
@@ -0,0 +1,327 @@
+#include "lp_reduction.h"
+
+#include <limits.h>
+
+#include <algorithm>
+
+#define SIDE_UNDECIDED 0
+#define SIDE_SOURCE 1
+#define SIDE_SINK 2
+
+LpRelaxation::LpRelaxation(int n)
+        : n(n), match_left(n, -1), match_right(n, -1), matching_size(0), adj_begin(n), adj_end(n),
+          dist(n), cursor(n), side(2 * n), index(2 * n), low(2 * n), component(2 * n), succ_pos(2 * n)
+{
+}
+
+auto LpRelaxation::copy_graph(const SparseGraph & g, const vector<int> & vv, const vector<bool> & deleted) -> void
+{
+    adj.clear();
+    for (int v : vv) {
+        adj_begin[v] = adj.size();
+        for (int w : g.neighbours(v))
+            if (!deleted[w])
+                adj.push_back(w);
+        adj_end[v] = adj.size();
+    }
+}
+
+// Label each left vertex with its distance from an unmatched left vertex in
+// the alternating-path layering, and return true if some unmatched right
+// vertex can be reached
+auto LpRelaxation::bfs(const vector<int> & vv) -> bool
+{
+    vector<int> queue;
+    for (int v : vv) {
+        if (match_left[v] == -1) {
+            dist[v] = 0;
+            queue.push_back(v);
+        } else {
+            dist[v] = INT_MAX;
+        }
+    }
+
+    bool found = false;
+    for (unsigned i=0; i<queue.size(); i++) {
+        int v = queue[i];
+        for (long j=adj_begin[v]; j<adj_end[v]; j++) {
+            int u = match_right[adj[j]];
+            if (u == -1) {
+                found = true;
+            } else if (dist[u] == INT_MAX) {
+                dist[u] = dist[v] + 1;
+                queue.push_back(u);
+            }
+        }
+    }
+    return found;
+}
+
+// Look for an augmenting path from the unmatched left vertex root along the
+// layering, by a depth-first search with an explicit stack, and augment the
+// matching along it if one is found.  The neighbour of path[i] that leads to
+// path[i+1] is adj[cursor[path[i]] - 1].
+auto LpRelaxation::augment(int root) -> bool
+{
+    path.clear();
+    path.push_back(root);
+    while (!path.empty()) {
+        int v = path.back();
+        if (cursor[v] == adj_end[v]) {
+            // no augmenting path goes through v in this phase
+            dist[v] = INT_MAX;
+            path.pop_back();
+            continue;
+        }
+        int w = adj[cursor[v]++];
+        int u = match_right[w];
+        if (u == -1) {
+            for (int x : path) {
+                int y = adj[cursor[x] - 1];
+                match_left[x] = y;
+                match_right[y] = x;
+            }
+            return true;
+        }
+        if (dist[u] == dist[v] + 1)
+            path.push_back(u);
+    }
+    return false;
+}
+
+auto LpRelaxation::find_maximum_matching(const vector<int> & vv) -> void
+{
+    for (int v : vv) {
+        if (match_left[v] != -1)
+            continue;
+        for (long j=adj_begin[v]; j<adj_end[v]; j++) {
+            int w = adj[j];
+            if (match_right[w] == -1) {
+                match_left[v] = w;
+                match_right[w] = v;
+                ++matching_size;
+                break;
+            }
+        }
+    }
+
+    while (bfs(vv)) {
+        for (int v : vv)
+            cursor[v] = adj_begin[v];
+        for (int v : vv)
+            if (match_left[v] == -1 && augment(v))
+                ++matching_size;
+    }
+}
+
+// Put each vertex of the double cover on the source side or the sink side of a
+// minimum cut of the flow network s -> v_L -> w_R -> t, where the middle arcs
+// come from the edges of the graph.  Vertex v_L is numbered v, and v_R is
+// numbered n + v.  The minimum vertex cover of the double cover is the v_L on
+// the sink side and the v_R on the source side.
+//
+// A cut is minimum if and only if no arc of the residual graph leaves the
+// source side.  Vertices reachable from s must therefore be on the source
+// side, and vertices that reach t on the sink side.  The rest are placed one
+// strongly connected component at a time, in reverse topological order, so
+// that a component's successors have been placed before it.  A component can
+// go on the source side if none of its successors is on the sink side, and
+// can always go on the sink side.  It goes on whichever side makes more of
+// its vertices' values integral, given where their twins have been placed.
+auto LpRelaxation::choose_minimum_cut(const vector<int> & vv) -> void
+{
+    for (int v : vv) {
+        for (int x : {v, n + v}) {
+            side[x] = SIDE_UNDECIDED;
+            index[x] = -1;
+            component[x] = -1;
+        }
+    }
+
+    // Residual arcs: v_L -> w_R for each edge vw, and w_R -> v_L and
+    // v_L -> s if v_L w_R is in the matching.  Unmatched vertices have arcs
+    // s -> v_L and w_R -> t.
+    vector<int> queue;
+    for (int v : vv) {
+        if (match_left[v] == -1) {
+            side[v] = SIDE_SOURCE;
+            queue.push_back(v);
+        }
+    }
+    for (unsigned i=0; i<queue.size(); i++) {
+        int x = queue[i];
+        if (x < n) {
+            for (long j=adj_begin[x]; j<adj_end[x]; j++) {
+                if (side[n + adj[j]] == SIDE_UNDECIDED) {
+                    side[n + adj[j]] = SIDE_SOURCE;
+                    queue.push_back(n + adj[j]);
+                }
+            }
+        } else {
+            int u = match_right[x - n];
+            if (u != -1 && side[u] == SIDE_UNDECIDED) {
+                side[u] = SIDE_SOURCE;
+                queue.push_back(u);
+            }
+        }
+    }
+
+    queue.clear();
+    for (int w : vv) {
+        if (match_right[w] == -1) {
+            side[n + w] = SIDE_SINK;
+            queue.push_back(n + w);
+        }
+    }
+    for (unsigned i=0; i<queue.size(); i++) {
+        int x = queue[i];
+        if (x >= n) {
+            for (long j=adj_begin[x - n]; j<adj_end[x - n]; j++) {
+                if (side[adj[j]] == SIDE_UNDECIDED) {
+                    side[adj[j]] = SIDE_SINK;
+                    queue.push_back(adj[j]);
+                }
+            }
+        } else {
+            int w = match_left[x];
+            if (w != -1 && side[n + w] == SIDE_UNDECIDED) {
+                side[n + w] = SIDE_SINK;
+                queue.push_back(n + w);
+            }
+        }
+    }
+
+    // Tarjan's algorithm, with an explicit call stack, over the undecided
+    // vertices.  The successors of x are visited by advancing succ_pos[x]:
+    // for a left vertex it indexes adj, and a right vertex has the single
+    // successor given by the matching.
+    vector<int> tarjan_stack;
+    vector<int> call_stack;
+    int next_index = 0;
+    int num_components = 0;
+
+    auto next_successor = [&](int x) -> int {
+        if (x < n)
+            return succ_pos[x] < adj_end[x] ? n + adj[succ_pos[x]++] : -1;
+        return succ_pos[x]++ == 0 ? match_right[x - n] : -1;
+    };
+
+    auto place_component = [&](int root) {
+        int c = num_components++;
+        auto first = tarjan_stack.end();
+        do {
+            --first;
+            component[*first] = c;
+        } while (*first != root);
+
+        bool can_be_source = true;
+        int source_gain = 0;
+        int sink_gain = 0;
+        for (auto it=first; it!=tarjan_stack.end(); ++it) {
+            int x = *it;
+            if (x < n) {
+                for (long j=adj_begin[x]; j<adj_end[x]; j++)
+                    if (component[n + adj[j]] != c && side[n + adj[j]] == SIDE_SINK)
+                        can_be_source = false;
+            } else {
+                int u = match_right[x - n];
+                if (component[u] != c && side[u] == SIDE_SINK)
+                    can_be_source = false;
+            }
+            int twin = x < n ? x + n : x - n;
+            if (side[twin] == SIDE_SINK)
+                ++source_gain;
+            else if (side[twin] == SIDE_SOURCE)
+                ++sink_gain;
+        }
+
+        char s = can_be_source && source_gain >= sink_gain ? SIDE_SOURCE : SIDE_SINK;
+        for (auto it=first; it!=tarjan_stack.end(); ++it)
+            side[*it] = s;
+        tarjan_stack.erase(first, tarjan_stack.end());
+    };
+
+    for (int v : vv) {
+        for (int start : {v, n + v}) {
+            if (side[start] != SIDE_UNDECIDED || index[start] != -1)
+                continue;
+            index[start] = low[start] = next_index++;
+            succ_pos[start] = start < n ? adj_begin[start] : 0;
+            tarjan_stack.push_back(start);
+            call_stack.push_back(start);
+            while (!call_stack.empty()) {
+                int x = call_stack.back();
+                int y = next_successor(x);
+                if (y != -1) {
+                    if (side[y] != SIDE_UNDECIDED)
+                        continue;
+                    if (index[y] == -1) {
+                        index[y] = low[y] = next_index++;
+                        succ_pos[y] = y < n ? adj_begin[y] : 0;
+                        tarjan_stack.push_back(y);
+                        call_stack.push_back(y);
+                    } else if (component[y] == -1) {
+                        low[x] = std::min(low[x], index[y]);
+                    }
+                } else {
+                    call_stack.pop_back();
+                    if (low[x] == index[x])
+                        place_component(x);
+                    if (!call_stack.empty())
+                        low[call_stack.back()] = std::min(low[call_stack.back()], low[x]);
+                }
+            }
+        }
+    }
+}
+
+auto LpRelaxation::solve(const SparseGraph & g, const vector<bool> & deleted,
+        vector<int> & zero_vv, vector<int> & one_vv) -> long
+{
+    vector<int> vv;
+    for (int v=0; v<n; v++)
+        if (!deleted[v])
+            vv.push_back(v);
+    return solve(g, vv, deleted, zero_vv, one_vv);
+}
+
+auto LpRelaxation::solve(const SparseGraph & g, const vector<int> & vv, const vector<bool> & deleted,
+        vector<int> & zero_vv, vector<int> & one_vv) -> long
+{
+    copy_graph(g, vv, deleted);
+
+    // Keep the pairs of the previous matching that are still edges between
+    // vertices of vv.  Only the entries of vv's vertices are cleaned up, so
+    // those of deleted vertices can be stale when the vertices come back;
+    // a pair is only kept if both of its ends still point to each other.
+    matching_size = 0;
+    for (int v : vv) {
+        int w = match_left[v];
+        if (w != -1 && (deleted[w] || match_right[w] != v || !g.has_edge(v, w))) {
+            match_left[v] = -1;
+            if (match_right[w] == v)
+                match_right[w] = -1;
+        }
+        int u = match_right[v];
+        if (u != -1 && (deleted[u] || match_left[u] != v || !g.has_edge(u, v))) {
+            match_right[v] = -1;
+            if (match_left[u] == v)
+                match_left[u] = -1;
+        }
+    }
+    for (int v : vv)
+        if (match_left[v] != -1)
+            ++matching_size;
+
+    find_maximum_matching(vv);
+
+    choose_minimum_cut(vv);
+    for (int v : vv) {
+        if (side[v] == SIDE_SOURCE && side[n + v] == SIDE_SINK)
+            zero_vv.push_back(v);
+        else if (side[v] == SIDE_SINK && side[n + v] == SIDE_SOURCE)
+            one_vv.push_back(v);
+    }
+
+    return (matching_size + 1) / 2;
+}
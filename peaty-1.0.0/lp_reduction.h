@@ -0,0 +1,132 @@
+#ifndef LP_REDUCTION_H
+#define LP_REDUCTION_H
+
+#include "sparse_graph.h"
+
+#include <vector>
+
+using std::vector;
+
+// The LP relaxation of vertex cover on the vertices of a graph that have not
+// been deleted.
+//
+// The relaxation is solved on the bipartite double cover, which has vertices
+// v_L and v_R for each vertex v, and edges v_L w_R and w_L v_R for each edge
+// vw.  A maximum matching of the double cover is twice the size of an optimal
+// LP solution, and each minimum vertex cover of it gives a half-integral
+// optimal solution in which x_v is half the number of v_L and v_R in the
+// cover.  By the Nemhauser-Trotter theorem, some minimum vertex cover of the
+// graph contains every vertex with x_v = 1 and none with x_v = 0.
+//
+// The matching is found by Hopcroft-Karp.  It is kept between calls of
+// solve(), so re-solving after a few reductions only needs a few augmenting
+// paths.  Given the list of vertices that are not deleted, solve() takes
+// time linear in their number and degrees rather than in n, because its
+// scratch arrays are kept too and only reset over those vertices.
+class LpRelaxation
+{
+    int n;
+
+    // match_left[v] is w if v_L is matched to w_R, and -1 if v_L is unmatched;
+    // match_right is the inverse
+    vector<int> match_left;
+    vector<int> match_right;
+    long matching_size;
+
+    // a copy of the adjacency lists of the vertices that have not been
+    // deleted, taken at the start of solve(); v's list is adj[adj_begin[v]]
+    // to adj[adj_end[v]-1]
+    vector<long> adj_begin;
+    vector<long> adj_end;
+    vector<int> adj;
+
+    // scratch space for Hopcroft-Karp
+    vector<int> dist;
+    vector<long> cursor;
+    vector<int> path;
+
+    // scratch space for choose_minimum_cut(), indexed by the vertices of the
+    // double cover
+    vector<char> side;
+    vector<int> index;
+    vector<int> low;
+    vector<int> component;
+    vector<long> succ_pos;
+
+    auto copy_graph(const SparseGraph & g, const vector<int> & vv, const vector<bool> & deleted) -> void;
+    auto bfs(const vector<int> & vv) -> bool;
+    auto augment(int root) -> bool;
+    auto find_maximum_matching(const vector<int> & vv) -> void;
+    auto choose_minimum_cut(const vector<int> & vv) -> void;
+
+public:
+    explicit LpRelaxation(int n);
+
+    // Solve the relaxation for the subgraph of g induced by the vertices that
+    // are not deleted, and put the vertices whose values are 0 and 1 in the
+    // optimal solution that is found in zero_vv and one_vv.  Return the LP optimum rounded up, which
+    // is a lower bound on the size of a vertex cover of what remains of g.
+    auto solve(const SparseGraph & g, const vector<bool> & deleted,
+            vector<int> & zero_vv, vector<int> & one_vv) -> long;
+
+    // The same, where vv lists exactly the vertices that are not deleted
+    auto solve(const SparseGraph & g, const vector<int> & vv, const vector<bool> & deleted,
+            vector<int> & zero_vv, vector<int> & one_vv) -> long;
+};
+
+// A greedy cover by cliques of some of the vertices of a graph (a colouring of
+// the complement), built with the vertices in the order they are given.  Each
+// vertex joins the largest clique whose members are all its neighbours, or
+// starts a new clique.  The number of cliques is an upper bound on the size of
+// an independent set, so the number of vertices minus it is a lower bound on
+// the size of a vertex cover.  The scratch space is kept between calls, so a
+// call takes time linear in the number of vertices given and their degrees.
+class GreedyCliqueCover
+{
+    // clique_of[v] is -1 except during count_cliques()
+    vector<int> clique_of;
+    vector<int> clique_size;
+    vector<int> num_neighbours_in_clique;
+
+public:
+    explicit GreedyCliqueCover(int n) : clique_of(n, -1) {}
+
+    // Cover vv, whose vertices should be in increasing order of degree, in the
+    // subgraph of g induced by the vertices v for which is_live(v) is true.
+    // Every vertex of vv must be live.  Return the number of cliques.
+    template<typename IsLive>
+    auto count_cliques(const SparseGraph & g, const vector<int> & vv, IsLive is_live) -> int
+    {
+        clique_size.clear();
+        num_neighbours_in_clique.clear();
+        for (int v : vv) {
+            for (int w : g.neighbours(v))
+                if (is_live(w) && clique_of[w] != -1)
+                    ++num_neighbours_in_clique[clique_of[w]];
+            int best = -1;
+            for (int w : g.neighbours(v)) {
+                if (!is_live(w) || clique_of[w] == -1)
+                    continue;
+                int c = clique_of[w];
+                if (num_neighbours_in_clique[c] == clique_size[c] && (best == -1 || clique_size[c] > clique_size[best]))
+                    best = c;
+            }
+            for (int w : g.neighbours(v))
+                if (is_live(w) && clique_of[w] != -1)
+                    num_neighbours_in_clique[clique_of[w]] = 0;
+
+            if (best == -1) {
+                best = clique_size.size();
+                clique_size.push_back(0);
+                num_neighbours_in_clique.push_back(0);
+            }
+            clique_of[v] = best;
+            ++clique_size[best];
+        }
+        for (int v : vv)
+            clique_of[v] = -1;
+        return clique_size.size();
+    }
+};
+
+#endif
@@ -9,15 +9,33 @@ struct Params
     int num_threads;
     bool quiet;
     bool unweighted_sort;
+    bool bitset_unit_propagation;
+    int local_search_threads;
+    int reduce_interval;
+
+    // the cover of each component may be up to absolute_gap vertices, or a
+    // fraction relative_gap, larger than the minimum
+    int absolute_gap;
+    double relative_gap;
+
+    // time the colourers and unit propagation at each node, for --stats
+    bool collect_stats;
 
     Params(int colouring_variant, int max_sat_level, int algorithm_num, int num_threads,
-            bool quiet, int unweighted_sort) :
+            bool quiet, int unweighted_sort, bool bitset_unit_propagation, int local_search_threads,
+            int reduce_interval, int absolute_gap, double relative_gap, bool collect_stats) :
             colouring_variant(colouring_variant),
             max_sat_level(max_sat_level),
             algorithm_num(algorithm_num),
             num_threads(num_threads),
             quiet(quiet),
-            unweighted_sort(unweighted_sort)
+            unweighted_sort(unweighted_sort),
+            bitset_unit_propagation(bitset_unit_propagation),
+            local_search_threads(local_search_threads),
+            reduce_interval(reduce_interval),
+            absolute_gap(absolute_gap),
+            relative_gap(relative_gap),
+            collect_stats(collect_stats)
     {}
 };
 
@@ -0,0 +1,637 @@
+#include "reductions.h"
+
+#include <algorithm>
+#include <iostream>
+
+// try_unconfined() gives up once its independent set S has this many vertices
+#define UNCONFINED_MAX_SET_SIZE 64u
+
+// a list of tuples (v, w, x), where v is the vertex of deg 2,
+// w is the kept neighbour and x is the removed neighbour
+struct Deg2Reduction : public Reduction
+{
+    int v;
+    int w;
+    int x;
+
+    Deg2Reduction(int v, int w, int x) : v(v), w(w), x(x) {}
+
+    void unwind(vector<bool> & in_cover)
+    {
+        if (in_cover[w]) {
+            in_cover[x] = true;
+        } else {
+            in_cover[v] = true;
+        }
+    }
+
+    ~Deg2Reduction() {}
+};
+
+// a list of tuples (v, w, x, y), where v is the vertex of deg 3,
+// and w and x are the kept neighbours
+struct FunnelReduction : public Reduction
+{
+    int v;
+    vector<int> ww;
+    int y;
+
+    FunnelReduction(int v, vector<int> ww, int y) : v(v), ww(ww), y(y) {}
+
+    bool all_ww_are_in_cover(vector<bool> & in_cover)
+    {
+        for (int w : ww)
+            if (!in_cover[w])
+                return false;
+        return true;
+    }
+
+    void unwind(vector<bool> & in_cover)
+    {
+        if (all_ww_are_in_cover(in_cover)) {
+            in_cover[y] = true;
+        } else {
+            in_cover[v] = true;
+        }
+    }
+
+    ~FunnelReduction() {}
+};
+
+struct BowTieReduction : public Reduction
+{
+    int v;
+    int a;
+    int b;
+    int c;
+    int d;
+
+    BowTieReduction(int v, int a, int b, int c, int d) : v(v), a(a), b(b), c(c), d(d) {}
+
+    void unwind(vector<bool> & in_cover)
+    {
+        if (!in_cover[a]) {
+            in_cover[c] = false;
+            in_cover[v] = true;
+        } else if (!in_cover[b]) {
+            in_cover[d] = false;
+            in_cover[v] = true;
+        } else if (!in_cover[c]) {
+            in_cover[b] = false;
+            in_cover[v] = true;
+        } else if (!in_cover[d]) {
+            in_cover[a] = false;
+            in_cover[v] = true;
+        } else {
+            in_cover[v] = false;
+        }
+    }
+
+    ~BowTieReduction() {}
+};
+
+// Twins u and v of degree 3 whose neighbours a, b and c are pairwise
+// non-adjacent, folded into a
+struct TwinReduction : public Reduction
+{
+    int u;
+    int v;
+    int a;
+    int b;
+    int c;
+
+    TwinReduction(int u, int v, int a, int b, int c) : u(u), v(v), a(a), b(b), c(c) {}
+
+    void unwind(vector<bool> & in_cover)
+    {
+        if (in_cover[a]) {
+            in_cover[b] = true;
+            in_cover[c] = true;
+        } else {
+            in_cover[u] = true;
+            in_cover[v] = true;
+        }
+    }
+
+    ~TwinReduction() {}
+};
+
+static bool has_any_edge(const SparseGraph & g, int v, const AdjList & ww)
+{
+    for (int w : ww)
+        if (w != v && g.has_edge(v, w))
+                return true;
+    return false;
+}
+
+// Count the pairs of non-adjacent vertices in vv, giving up once the count exceeds limit
+static int num_missing_edges(const SparseGraph & g, const AdjList & vv, int limit)
+{
+    int retval = 0;
+    for (auto it=vv.begin(); it!=vv.end(); ++it) {
+        for (auto it2=std::next(it); it2!=vv.end(); ++it2) {
+            if (!g.has_edge(*it, *it2) && ++retval > limit) {
+                return retval;
+            }
+        }
+    }
+    return retval;
+}
+
+static bool are_bow_tie(const SparseGraph & g, const AdjList & adjlist)
+{
+    for (int v : adjlist) {
+        int num_edges = 0;
+        for (int w : adjlist) {
+            if (v != w) {
+                if (g.has_edge(v, w)) {
+                    ++num_edges;
+                    if (num_edges > 1) {
+                        break;
+                    }
+                }
+            }
+        }
+        if (num_edges != 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char * const kernelizer_rule_names[NUM_KERNELIZER_RULES] = {
+    "isolated vertex removal", "domination", "vertex folding", "funnel", "twin", "unconfined", "LP"
+};
+
+Kernelizer::Kernelizer(SparseGraph & g, vector<bool> & in_cover, vector<bool> & deleted,
+        vector<std::unique_ptr<Reduction>> & reductions, const KernelizerOptions & options)
+        : g(g), in_cover(in_cover), deleted(deleted), reductions(reductions), options(options), worklist(g.n),
+          lp(options.lp ? g.n : 0), in_s(g.n), num_s_neighbours(g.n), num_deleted(0), lp_lower_bound(0)
+{
+    // the rules below make many edge queries within neighbourhoods
+    g.build_edge_index();
+}
+
+auto Kernelizer::touch(int v) -> void
+{
+    if (!deleted[v])
+        worklist.push(v, g.neighbours(v).size());
+}
+
+// The isolated vertex, domination, folding and funnel rules look only at edges
+// within the closed neighbourhood of the vertex they are applied to.  An edge
+// {v, w} lies in N[u] only if u is in N[v] or N[w], so after a rule has run it
+// is sufficient for those rules to re-examine the closed neighbourhoods of the
+// vertices whose adjacency lists changed.  The twin rule looks at distance 2
+// and the unconfined rule further, so a change can enable them at a vertex
+// that is not re-examined here; run() catches these with a final sweep.
+auto Kernelizer::touch_changed_neighbourhoods() -> void
+{
+    for (int v : changed_vv) {
+        touch(v);
+        for (int w : g.neighbours(v))
+            touch(w);
+    }
+    changed_vv.clear();
+}
+
+auto Kernelizer::delete_vertex(int v) -> void
+{
+    for (int u : g.neighbours(v))
+        changed_vv.push_back(u);
+    g.isolate_vertex(v);
+    deleted[v] = true;
+    ++num_deleted;
+    worklist.remove(v);
+}
+
+auto Kernelizer::add_edge_if_absent(int v, int w) -> void
+{
+    if (!g.has_edge(v, w)) {
+        g.add_edge(v, w);
+        changed_vv.push_back(v);
+        changed_vv.push_back(w);
+    }
+}
+
+// If the neighbourhood of v is a clique, its members can go in the cover and
+// v can be deleted.
+auto Kernelizer::try_isolated_vertex_removal(int v) -> bool
+{
+    auto lst = g.neighbours(v);
+
+    // each neighbour must be adjacent to v and to all of v's other neighbours
+    for (int w : lst)
+        if (g.neighbours(w).size() < lst.size())
+            return false;
+
+    if (!g.vv_are_clique(lst))
+        return false;
+
+    vector<int> neighbours = lst.to_vector();
+    for (int w : neighbours) {
+        in_cover[w] = true;
+        delete_vertex(w);
+    }
+    deleted[v] = true;
+    ++num_deleted;
+    worklist.remove(v);
+    return true;
+}
+
+// If there is a vertex v with a neighbour w who is adjacent to all of v's other neighbours,
+// it's safe to assume that w is in the vertex cover.
+auto Kernelizer::try_domination(int v) -> bool
+{
+    auto lst = g.neighbours(v);
+    if (lst.size() <= 2)
+        return false;
+
+    for (int w : lst) {
+        // N[v] is a subset of N[w], so w can't have a smaller degree than v
+        if (g.neighbours(w).size() < lst.size())
+            continue;
+        unsigned num_edges = 0;
+        for (int x : lst) {
+            if (x != w) {
+                if (g.has_edge(x, w)) {
+                    ++num_edges;
+                } else {
+                    break;
+                }
+            }
+        }
+        if (num_edges == lst.size() - 1) {
+            in_cover[w] = true;
+            delete_vertex(w);
+            return true;
+        }
+    }
+    return false;
+}
+
+auto Kernelizer::try_vertex_folding(int v) -> bool
+{
+    if (g.neighbours(v).size() != 2)
+        return false;
+
+    int w = g.neighbours(v)[0];
+    int x = g.neighbours(v)[1];
+
+    // for this reduction, w and x must not be adjacent
+    if (g.has_edge(x, w))
+        return false;
+
+    delete_vertex(v);
+    vector<int> x_neighbours = g.neighbours(x).to_vector();
+    delete_vertex(x);
+    for (int u : x_neighbours)
+        add_edge_if_absent(w, u);
+    reductions.push_back(std::make_unique<Deg2Reduction>(v, w, x));
+    return true;
+}
+
+// TODO: maybe do the normal, more general version of funnel
+// in which y can be adjacent so some of ww
+//
+// Try to find vertex v with neighbours ww and y, such that ws are a clique
+// and y is not adjacent to any member of ww.
+// We can then delete v and y, adding the neighbours
+// of y other than x to the adjacency list of each vertex in ww.
+auto Kernelizer::try_funnel(int v) -> bool
+{
+    auto lst = g.neighbours(v);
+    int lst_sz = lst.size();
+    if (lst_sz < 3)
+        return false;
+
+    // all neighbours but y are in a clique with v, so have degree at least lst_sz-1
+    int num_low_degree_neighbours = 0;
+    for (int w : lst)
+        if (int(g.neighbours(w).size()) < lst_sz - 1)
+            if (++num_low_degree_neighbours > 1)
+                return false;
+
+    // y must be the only vertex in lst that is missing any edges
+    if (num_missing_edges(g, lst, lst_sz-1) != lst_sz-1)
+        return false;
+
+    for (int y : lst) {
+        if (!has_any_edge(g, y, lst)) {
+            vector<int> ww;
+            for (int w : lst)
+                if (w != y)
+                    ww.push_back(w);
+
+            delete_vertex(v);
+            vector<int> y_neighbours = g.neighbours(y).to_vector();
+            delete_vertex(y);
+            for (int u : y_neighbours)
+                for (int w : ww)
+                    add_edge_if_absent(u, w);
+            reductions.push_back(std::make_unique<FunnelReduction>(v, ww, y));
+            return true;
+        }
+    }
+    return false;
+}
+
+auto Kernelizer::try_bow_tie(int v) -> bool
+{
+    if (g.neighbours(v).size() != 4)
+        return false;
+
+    auto lst_v = g.neighbours(v);
+    if (!are_bow_tie(g, lst_v))
+        return false;
+
+    int a = lst_v[0];
+    int b = lst_v[1];
+    int c = lst_v[2];
+    int d = lst_v[3];
+    if (g.has_edge(a, c)) {
+        std::swap(b, c);
+    } else if (g.has_edge(a, d)) {
+        std::swap(b, d);
+    }
+
+    delete_vertex(v);
+
+    vector<int> adjlist_a = g.neighbours(a).to_vector();
+    vector<int> adjlist_b = g.neighbours(b).to_vector();
+    vector<int> adjlist_c = g.neighbours(c).to_vector();
+    vector<int> adjlist_d = g.neighbours(d).to_vector();
+    for (int u : adjlist_c)
+        add_edge_if_absent(a, u);
+    for (int u : adjlist_d)
+        add_edge_if_absent(b, u);
+    for (int u : adjlist_b)
+        add_edge_if_absent(c, u);
+    for (int u : adjlist_a)
+        add_edge_if_absent(d, u);
+
+    reductions.push_back(std::make_unique<BowTieReduction>(v, a, b, c, d));
+    return true;
+}
+
+// Vertices u and v of degree 3 are twins if N(u) = N(v).  If there is an edge
+// within N(v), some minimum vertex cover contains N(v) but neither twin.
+// Otherwise, the twins and two of their neighbours are folded into the third
+// neighbour a: it gets the neighbours of the other two.  If a is in a cover
+// of the folded graph, all three neighbours are in the cover; if not, the
+// twins are.
+auto Kernelizer::try_twin(int v) -> bool
+{
+    if (g.degree(v) != 3)
+        return false;
+
+    vector<int> nv = g.neighbours(v).to_vector();
+
+    // look for a twin among the neighbours of v's neighbour of lowest degree
+    int x = nv[0];
+    for (int w : nv)
+        if (g.degree(w) < g.degree(x))
+            x = w;
+    int u = -1;
+    for (int w : g.neighbours(x)) {
+        if (w != v && g.degree(w) == 3 && g.has_edge(w, nv[0]) && g.has_edge(w, nv[1]) &&
+                g.has_edge(w, nv[2])) {
+            u = w;
+            break;
+        }
+    }
+    if (u == -1)
+        return false;
+
+    int a = nv[0];
+    int b = nv[1];
+    int c = nv[2];
+    if (g.has_edge(a, b) || g.has_edge(a, c) || g.has_edge(b, c)) {
+        for (int w : nv) {
+            in_cover[w] = true;
+            delete_vertex(w);
+        }
+        delete_vertex(u);
+        delete_vertex(v);
+        return true;
+    }
+
+    delete_vertex(u);
+    delete_vertex(v);
+    vector<int> b_neighbours = g.neighbours(b).to_vector();
+    vector<int> c_neighbours = g.neighbours(c).to_vector();
+    delete_vertex(b);
+    delete_vertex(c);
+    for (int w : b_neighbours)
+        add_edge_if_absent(a, w);
+    for (int w : c_neighbours)
+        add_edge_if_absent(a, w);
+    reductions.push_back(std::make_unique<TwinReduction>(u, v, a, b, c));
+    return true;
+}
+
+// Vertex v is unconfined, and some minimum vertex cover contains it, if the
+// following process (Xiao and Nagamochi) ends in a contradiction.  Let S be
+// the independent set {v}, and call a vertex of N(S) with exactly one
+// neighbour in S a child.  Find the child u with the fewest neighbours
+// outside N[S].  If u has no such neighbours, v is unconfined.  If u has
+// exactly one such neighbour w, add w to S and repeat.  Otherwise, or if
+// there are no children, v is confined.  The rule generalises domination.
+auto Kernelizer::try_unconfined(int v) -> bool
+{
+    vector<int> s_vv {v};
+    vector<int> s_neighbours;
+    in_s[v] = true;
+    for (int u : g.neighbours(v)) {
+        num_s_neighbours[u] = 1;
+        s_neighbours.push_back(u);
+    }
+
+    bool unconfined = false;
+    while (s_vv.size() <= UNCONFINED_MAX_SET_SIZE) {
+        int best_num_outside = 2;
+        int best_w = -1;
+        for (int u : s_neighbours) {
+            if (num_s_neighbours[u] != 1)
+                continue;
+            int num_outside = 0;
+            int w_outside = -1;
+            for (int w : g.neighbours(u)) {
+                if (!in_s[w] && num_s_neighbours[w] == 0) {
+                    w_outside = w;
+                    if (++num_outside == 2)
+                        break;
+                }
+            }
+            if (num_outside < best_num_outside) {
+                best_num_outside = num_outside;
+                best_w = w_outside;
+                if (num_outside == 0)
+                    break;
+            }
+        }
+
+        if (best_num_outside == 0)
+            unconfined = true;
+        if (best_num_outside != 1)
+            break;
+
+        in_s[best_w] = true;
+        s_vv.push_back(best_w);
+        for (int x : g.neighbours(best_w))
+            if (num_s_neighbours[x]++ == 0)
+                s_neighbours.push_back(x);
+    }
+
+    for (int w : s_vv)
+        in_s[w] = false;
+    for (int x : s_neighbours)
+        num_s_neighbours[x] = 0;
+
+    if (!unconfined)
+        return false;
+    in_cover[v] = true;
+    delete_vertex(v);
+    return true;
+}
+
+// Solve the LP relaxation, put the vertices whose value is 1 in the cover and
+// delete those whose value is 0, which are isolated once the others have gone
+auto Kernelizer::try_lp_reduction() -> bool
+{
+    vector<int> zero_vv;
+    vector<int> one_vv;
+    lp_lower_bound = lp.solve(g, deleted, zero_vv, one_vv);
+
+    for (int v : one_vv) {
+        in_cover[v] = true;
+        delete_vertex(v);
+    }
+    for (int v : zero_vv)
+        delete_vertex(v);
+
+    return !zero_vv.empty() || !one_vv.empty();
+}
+
+auto Kernelizer::try_rule(KernelizerRule rule, int v) -> bool
+{
+    auto start = options.collect_stats ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    long num_deleted_before = num_deleted;
+    bool made_a_change = false;
+    switch (rule) {
+        case RULE_ISOLATED_VERTEX_REMOVAL: made_a_change = try_isolated_vertex_removal(v); break;
+        case RULE_DOMINATION: made_a_change = try_domination(v); break;
+        case RULE_VERTEX_FOLDING: made_a_change = try_vertex_folding(v); break;
+        case RULE_FUNNEL: made_a_change = try_funnel(v); break;
+        case RULE_TWIN: made_a_change = try_twin(v); break;
+        case RULE_UNCONFINED: made_a_change = try_unconfined(v); break;
+        case RULE_LP: made_a_change = try_lp_reduction(); break;
+        case NUM_KERNELIZER_RULES: break;
+    }
+    stats.removed[rule] += num_deleted - num_deleted_before;
+    if (options.collect_stats)
+        stats.time[rule] += std::chrono::steady_clock::now() - start;
+    return made_a_change;
+}
+
+auto Kernelizer::run() -> void
+{
+    for (unsigned v=0; v<g.n; v++)
+        touch(v);
+    long num_deleted_at_last_sweep = 0;
+
+    for (;;) {
+        while (!worklist.empty()) {
+            int v = worklist.pop();
+            // the bow-tie rule (try_bow_tie) is currently disabled
+            bool made_a_change = try_rule(RULE_ISOLATED_VERTEX_REMOVAL, v) ||
+                    try_rule(RULE_DOMINATION, v) ||
+                    try_rule(RULE_VERTEX_FOLDING, v) ||
+                    try_rule(RULE_FUNNEL, v) ||
+                    (options.twin && try_rule(RULE_TWIN, v)) ||
+                    (options.unconfined && try_rule(RULE_UNCONFINED, v));
+            if (made_a_change)
+                touch_changed_neighbourhoods();
+        }
+        if (options.lp && try_rule(RULE_LP, -1)) {
+            touch_changed_neighbourhoods();
+            continue;
+        }
+
+        // Every change deletes a vertex.  If there have been changes since
+        // all vertices were last examined, the twin and unconfined rules may
+        // apply at vertices that touch_changed_neighbourhoods() didn't reach.
+        if (!(options.twin || options.unconfined) || num_deleted == num_deleted_at_last_sweep)
+            break;
+        num_deleted_at_last_sweep = num_deleted;
+        for (unsigned v=0; v<g.n; v++)
+            touch(v);
+    }
+}
+
+auto check_adj_list_integrity(const SparseGraph & g) -> bool
+{
+    // Each list must lie within the slots array, and its degree must be its
+    // number of entries that are not tombstones
+    for (unsigned v=0; v<g.n; v++) {
+        auto & e = g.adj_extent[v];
+        if (e.len > e.capacity || e.begin + e.capacity > g.adj_slots.size() ||
+                std::count(g.adj_slots.begin() + e.begin, g.adj_slots.begin() + e.begin + e.len,
+                        ADJ_LIST_TOMBSTONE) != e.len - e.degree) {
+            std::cout << "Adjacency list extent error" << std::endl;
+            return false;
+        }
+    }
+
+    // Build the transpose of the adjacency lists, then check that each vertex's
+    // list and its transposed list contain the same vertices.
+    vector<vector<int>> transposed(g.n);
+    for (unsigned v=0; v<g.n; v++)
+        for (int w : g.neighbours(v))
+            transposed[w].push_back(v);
+
+    vector<int> stamp(g.n, -1);
+    for (unsigned v=0; v<g.n; v++) {
+        for (int w : g.neighbours(v)) {
+            if (stamp[w] == int(v)) {
+                std::cout << "Duplicate edge" << std::endl;
+                return false;
+            }
+            stamp[w] = v;
+        }
+        if (transposed[v].size() != g.neighbours(v).size()) {
+            std::cout << "Graph error" << std::endl;
+            return false;
+        }
+        for (int w : transposed[v]) {
+            if (stamp[w] != int(v)) {
+                std::cout << "Graph error" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    if (g.has_edge_index) {
+        long indexed_endpoint_count = 0;
+        for (unsigned v=0; v<g.n; v++) {
+            if (g.neighbours(v).size() > EDGE_INDEX_MIN_DEGREE && !g.vertex_is_indexed[v]) {
+                std::cout << "Edge index error" << std::endl;
+                return false;
+            }
+            for (int w : g.neighbours(v)) {
+                if (g.edge_is_indexed(v, w)) {
+                    ++indexed_endpoint_count;
+                    if (!g.edge_index.contains(v, w)) {
+                        std::cout << "Edge index error" << std::endl;
+                        return false;
+                    }
+                }
+            }
+        }
+        if (g.edge_index.size != indexed_endpoint_count / 2) {
+            std::cout << "Edge index error" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
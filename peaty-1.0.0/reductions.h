@@ -0,0 +1,118 @@
+#ifndef REDUCTIONS_H
+#define REDUCTIONS_H
+
+#include "degree_bucket_queue.h"
+#include "lp_reduction.h"
+#include "sparse_graph.h"
+#include "stats.h"
+
+#include <memory>
+#include <vector>
+
+using std::vector;
+
+struct Reduction
+{
+    virtual void unwind(vector<bool> & in_cover) = 0;
+    virtual ~Reduction() {}
+};
+
+// The reduction rules that can be switched off, and whether to time each rule
+struct KernelizerOptions
+{
+    bool lp = true;
+    bool unconfined = true;
+    bool twin = true;
+    bool collect_stats = false;
+};
+
+// The rules, in the order in which the kernelizer tries them
+enum KernelizerRule
+{
+    RULE_ISOLATED_VERTEX_REMOVAL,
+    RULE_DOMINATION,
+    RULE_VERTEX_FOLDING,
+    RULE_FUNNEL,
+    RULE_TWIN,
+    RULE_UNCONFINED,
+    RULE_LP,
+    NUM_KERNELIZER_RULES
+};
+
+extern const char * const kernelizer_rule_names[NUM_KERNELIZER_RULES];
+
+// The number of vertices that each rule has removed, and the time spent
+// trying it if options.collect_stats is set
+struct KernelizerStats
+{
+    long removed[NUM_KERNELIZER_RULES] = {};
+    Duration time[NUM_KERNELIZER_RULES] = {};
+};
+
+// Applies the local reduction rules (isolated vertex removal, domination,
+// degree-2 folding, funnel, twin and unconfined) and the LP reduction until
+// none of them applies.
+//
+// Rather than sweeping over all vertices until nothing changes, the kernelizer
+// keeps a worklist of vertices whose closed neighbourhood has changed since
+// they were last examined.  The worklist is bucketed by degree, so that cheap
+// low-degree rules are tried first.  The LP reduction looks at the whole
+// graph, so it is only tried when the worklist is empty.
+class Kernelizer
+{
+    SparseGraph & g;
+    vector<bool> & in_cover;
+    vector<bool> & deleted;
+    vector<std::unique_ptr<Reduction>> & reductions;
+
+    KernelizerOptions options;
+    DegreeBucketQueue worklist;
+    LpRelaxation lp;
+
+    // scratch space for try_unconfined(); in_s and num_s_neighbours are
+    // all false and zero between calls
+    vector<bool> in_s;
+    vector<int> num_s_neighbours;
+
+    // vertices whose adjacency lists were modified by the current rule
+    vector<int> changed_vv;
+
+    // the number of vertices deleted so far
+    long num_deleted;
+
+    auto touch(int v) -> void;
+    auto touch_changed_neighbourhoods() -> void;
+    auto delete_vertex(int v) -> void;
+    auto add_edge_if_absent(int v, int w) -> void;
+
+    auto try_isolated_vertex_removal(int v) -> bool;
+    auto try_domination(int v) -> bool;
+    auto try_vertex_folding(int v) -> bool;
+    auto try_funnel(int v) -> bool;
+    auto try_bow_tie(int v) -> bool;
+    auto try_twin(int v) -> bool;
+    auto try_unconfined(int v) -> bool;
+    auto try_lp_reduction() -> bool;
+
+    // Try rule, at v unless it is the LP reduction, and record what it
+    // removed and how long it took in stats
+    auto try_rule(KernelizerRule rule, int v) -> bool;
+
+public:
+    KernelizerStats stats;
+
+    // the LP lower bound on the size of a vertex cover of the kernel, if the
+    // LP reduction is used
+    long lp_lower_bound;
+
+    Kernelizer(SparseGraph & g, vector<bool> & in_cover, vector<bool> & deleted,
+            vector<std::unique_ptr<Reduction>> & reductions, const KernelizerOptions & options);
+
+    auto run() -> void;
+};
+
+// Check that adjacency lists are symmetric and free of duplicates, and that
+// the edge index (if any) matches them, in O(n+m) expected time.
+auto check_adj_list_integrity(const SparseGraph & g) -> bool;
+
+#endif
@@ -16,8 +16,8 @@ vector<int> initialise(const SparseGraph & g) {
 
     vector<int> residual_degs;
     residual_degs.reserve(g.n);
-    for (auto & lst : g.adjlist)
-        residual_degs.push_back(lst.size());
+    for (unsigned v=0; v<g.n; v++)
+        residual_degs.push_back(g.degree(v));
 
     vector<int> ll_next(g.n * 2);
     vector<int> ll_prev(g.n * 2);
@@ -61,7 +61,7 @@ vector<int> initialise(const SparseGraph & g) {
         ll_next[ll_prev[v]] = ll_next[v];
         ll_prev[ll_next[v]] = ll_prev[v];
 
-        for (int neighbour : g.adjlist[v]) {
+        for (int neighbour : g.neighbours(v)) {
             if (!in_vv[neighbour]) {
                 // remove from list
                 ll_next[ll_prev[neighbour]] = ll_next[neighbour];
@@ -85,7 +85,7 @@ vector<int> initialise(const SparseGraph & g) {
 vector<long> calc_weighted_degs(const SparseGraph & g) {
     vector<long> weighted_degs(g.n);
     for (int v=0; v<int(g.n); v++)
-        for (auto w : g.adjlist[v])
+        for (auto w : g.neighbours(v))
             weighted_degs[w] += g.weight[v];
 
     return weighted_degs;
@@ -130,7 +130,7 @@ auto reduce_and_reverse_cp_order(vector<int> & vv, const SparseGraph & g,
         if (new_sz==i+1 && g.weight[v] + best_wt_deg + current_wt <= incumbent_wt)
             --new_sz;
 
-        for (int neighbour : g.adjlist[v])
+        for (int neighbour : g.neighbours(v))
             residual_weighted_degs[neighbour] -= g.weight[v];
     }
 
@@ -6,12 +6,20 @@
 #include "root_node_processing.h"
 #include "params.h"
 #include "graph_colour_solver.h"
+#include "lp_reduction.h"
+#include "branch_and_reduce.h"
+#include "stats.h"
 
-#include <iostream>  // TODO: don't include this
+#include <stdio.h>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <random>
+#include <thread>
 #include <vector>
 
 class FastSet
@@ -47,290 +55,917 @@ public:
         return in_set[x];
     }
 
+    // An element chosen uniformly at random; the set must be non-empty
+    int random_element(std::mt19937 & rng)
+    {
+        return elements[std::uniform_int_distribution<unsigned>(0, elements.size() - 1)(rng)];
+    }
+
     unsigned size()
     {
         return elements.size();
     }
 };
 
+// The vertex removed from the cover in each local search step is the best
+// vertex of the cover if the cover is no larger than this, and otherwise the
+// best of LOCAL_SEARCH_SAMPLE_SIZE randomly chosen vertices of the cover
+#define LOCAL_SEARCH_MAX_COVER_SIZE_FOR_FULL_SCAN 1000
+#define LOCAL_SEARCH_SAMPLE_SIZE 50
+
+// Edge weights are scaled down by LOCAL_SEARCH_WEIGHT_DECAY_FACTOR when their
+// mean exceeds LOCAL_SEARCH_WEIGHT_DECAY_THRESHOLD times the number of vertices
+#define LOCAL_SEARCH_WEIGHT_DECAY_THRESHOLD 0.5
+#define LOCAL_SEARCH_WEIGHT_DECAY_FACTOR 0.3
+
+// A call of LocalSearcher::search() stops once it has gone this many
+// nanoseconds per vertex without finding a larger independent set, clamped to
+// the range below
+#define LOCAL_SEARCH_NANOSECONDS_PER_VERTEX 40000
+#define LOCAL_SEARCH_MIN_ROUND_MICROSECONDS 100
+#define LOCAL_SEARCH_MAX_ROUND_MICROSECONDS 20000
+
+// During the clique search, the local search is run whenever it has had less
+// than this fraction of the time since it was created
+#define LOCAL_SEARCH_TIME_SHARE 0.1
+
+// The clock is read once per this many local search steps
+#define LOCAL_SEARCH_STEPS_PER_CLOCK_CHECK 256
+
+// During the clique search, whether the local search is due is checked once
+// per this many search nodes
+#define LOCAL_SEARCH_NODES_PER_DUE_CHECK 64
+
+// The weight and size of the best independent set found so far in a
+// component.  The clique search and the local search threads raise and read
+// these without locking.
+struct SharedIncumbent
+{
+    std::atomic<long> wt;
+    std::atomic<int> size;
+
+    SharedIncumbent(long wt, int size) : wt(wt), size(size) {}
+
+    auto raise(long new_wt, int new_size) -> void
+    {
+        long old_wt = wt.load(std::memory_order_relaxed);
+        while (old_wt < new_wt && !wt.compare_exchange_weak(old_wt, new_wt))
+            ;
+        int old_size = size.load(std::memory_order_relaxed);
+        while (old_size < new_size && !size.compare_exchange_weak(old_size, new_size))
+            ;
+    }
+};
+
+// How far an independent set of weight incumbent_wt in a graph of n unit-weight
+// vertices may fall short of the maximum under params.absolute_gap and
+// params.relative_gap.  A cover of size c is within a fraction r of the
+// minimum if the minimum is at least c - c*r/(1+r).
+static auto allowed_gap(const Params & params, unsigned n, long incumbent_wt) -> long
+{
+    long cover_size = n - incumbent_wt;
+    return std::max(long(params.absolute_gap),
+            long(params.relative_gap / (1 + params.relative_gap) * cover_size));
+}
+
+// Local search for a large independent set, after NuMVC (Cai et al., "NuMVC:
+// An efficient local search algorithm for minimum vertex cover", JAIR 2013).
+// The search works on the complementary vertex cover C, and each time C covers
+// every edge, the vertices outside C are a new independent set and a vertex is
+// dropped from C.
+//
+// Each edge has a weight, which grows by one for each step during which the
+// edge is uncovered, and the dscore of a vertex is the decrease in the total
+// weight of uncovered edges if it is added to or removed from C.  A step
+// removes from C the best of a random sample of its vertices (other than the
+// vertex just added), then adds the better endpoint of a random uncovered
+// edge.  By configuration checking, a vertex that has left C may only re-enter
+// it once one of its neighbours has changed state.
+//
+// The state persists between calls of search(), each of which runs until it
+// has gone a fixed amount of time without an improvement.  A step takes time
+// proportional to the degrees of the two vertices it moves plus the number of
+// uncovered edges, plus the size of the cover if it is small enough to scan.
 class LocalSearcher
 {
     const SparseGraph & g;
-    vector<int> num_conflicts;
-    FastSet set_of_vv_with_no_conflicts;
-    FastSet set_of_vv_with_one_conflict;
-    vector<bool> ind_set;
-    int ind_set_size;
-    int tabu_duration;
-    unsigned long long time;
-    unsigned long long local_time_limit = 5000;
-    vector<int> last_time_changed;
     VtxList & incumbent;
+    SharedIncumbent * shared_incumbent;
     std::mt19937 mt19937;
 
-public:
-    LocalSearcher(const SparseGraph & g, VtxList & incumbent) : g(g), num_conflicts(g.n),
-            set_of_vv_with_no_conflicts(g.n), set_of_vv_with_one_conflict(g.n), ind_set(g.n),
-            tabu_duration(10), time(tabu_duration + 1), last_time_changed(g.n), incumbent(incumbent)
+    // the edges incident to v are adj_edge[adj_start[v]] to adj_edge[adj_start[v+1]-1],
+    // and lead to the corresponding vertices in adj_vertex
+    vector<unsigned long long> adj_start;
+    vector<int> adj_vertex;
+    vector<int> adj_edge;
+
+    vector<Edge> edge_endpoints;
+    vector<long> edge_weight;
+    long total_edge_weight;
+
+    vector<bool> in_cover;
+    FastSet cover;
+    FastSet uncovered_edges;
+    vector<long> dscore;
+    vector<bool> conf_change;
+
+    // the step at which each vertex last entered or left the cover; ties
+    // between vertices with equal dscores are broken in favour of the oldest
+    vector<unsigned long long> last_moved;
+
+    // the vertex added to the cover in the previous step, which may not be removed
+    int tabu_vertex;
+
+    unsigned long long step;
+    std::chrono::steady_clock::duration round_time_limit;
+
+    // when the searcher was created, and the total time spent in search()
+    std::chrono::steady_clock::time_point start_time;
+    std::chrono::steady_clock::duration time_used;
+
+    auto is_better(int v, int w) const -> bool
+    {
+        return dscore[v] > dscore[w] || (dscore[v] == dscore[w] && last_moved[v] < last_moved[w]);
+    }
+
+    auto add_to_cover(int v) -> void
     {
-        for (unsigned i=0; i<g.n; i++) {
-            set_of_vv_with_no_conflicts.add(i);
-            set_of_vv_with_one_conflict.remove(i);
+        in_cover[v] = true;
+        cover.add(v);
+        dscore[v] = -dscore[v];
+        last_moved[v] = step;
+        for (unsigned long long i=adj_start[v]; i<adj_start[v + 1]; i++) {
+            int w = adj_vertex[i];
+            int e = adj_edge[i];
+            conf_change[w] = true;
+            if (in_cover[w]) {
+                dscore[w] += edge_weight[e];
+            } else {
+                dscore[w] -= edge_weight[e];
+                uncovered_edges.remove(e);
+            }
         }
     }
 
-    unsigned long long get_time()
+    auto remove_from_cover(int v) -> void
     {
-        return time;
+        in_cover[v] = false;
+        cover.remove(v);
+        dscore[v] = -dscore[v];
+        last_moved[v] = step;
+        conf_change[v] = false;
+        for (unsigned long long i=adj_start[v]; i<adj_start[v + 1]; i++) {
+            int w = adj_vertex[i];
+            int e = adj_edge[i];
+            conf_change[w] = true;
+            if (in_cover[w]) {
+                dscore[w] -= edge_weight[e];
+            } else {
+                dscore[w] += edge_weight[e];
+                uncovered_edges.add(e);
+            }
+        }
     }
 
-    void reset()
+    // The best vertex of the cover, or of a sample of it if it is large.  The
+    // cover must be non-empty.
+    auto choose_vertex_to_remove() -> int
     {
-        std::fill(num_conflicts.begin(), num_conflicts.end(), 0);
-        std::fill(ind_set.begin(), ind_set.end(), false);
-        std::fill(last_time_changed.begin(), last_time_changed.end(), 0);
-        ind_set_size = 0;
-        for (unsigned i=0; i<g.n; i++) {
-            set_of_vv_with_no_conflicts.add(i);
-            set_of_vv_with_one_conflict.remove(i);
+        int best = -1;
+        bool sample = cover.size() > LOCAL_SEARCH_MAX_COVER_SIZE_FOR_FULL_SCAN;
+        for (unsigned i=0; i<(sample ? LOCAL_SEARCH_SAMPLE_SIZE : cover.size()); i++) {
+            int v = sample ? cover.random_element(mt19937) : cover.elements[i];
+            if (v != tabu_vertex && (best == -1 || is_better(v, best)))
+                best = v;
         }
+        return best == -1 ? tabu_vertex : best;
     }
 
-    void add_to_ind_set(int v)
+    auto choose_vertex_to_add() -> int
     {
-        ind_set[v] = true;
-        ++ind_set_size;
-        for (int w : g.adjlist[v]) {
-            if (num_conflicts[w] == 0) {
-                set_of_vv_with_no_conflicts.remove(w);
-                set_of_vv_with_one_conflict.add(w);
-            } else if (num_conflicts[w] == 1) {
-                set_of_vv_with_one_conflict.remove(w);
+        Edge e = edge_endpoints[uncovered_edges.random_element(mt19937)];
+        int v = e.first;
+        int w = e.second;
+        if (!conf_change[v])
+            return w;
+        if (!conf_change[w])
+            return v;
+        return is_better(v, w) ? v : w;
+    }
+
+    auto recalculate_dscores() -> void
+    {
+        std::fill(dscore.begin(), dscore.end(), 0);
+        for (unsigned e=0; e<edge_endpoints.size(); e++) {
+            int v = edge_endpoints[e].first;
+            int w = edge_endpoints[e].second;
+            if (!in_cover[v] && !in_cover[w]) {
+                dscore[v] += edge_weight[e];
+                dscore[w] += edge_weight[e];
+            } else if (!in_cover[w]) {
+                dscore[v] -= edge_weight[e];
+            } else if (!in_cover[v]) {
+                dscore[w] -= edge_weight[e];
             }
-            ++num_conflicts[w];
         }
     }
 
-    void remove_from_ind_set(int v)
+    auto increase_weights_of_uncovered_edges() -> void
     {
-        last_time_changed[v] = time;
-        ind_set[v] = false;
-        --ind_set_size;
-        for (int w : g.adjlist[v]) {
-            --num_conflicts[w];
-            if (num_conflicts[w] == 0) {
-                set_of_vv_with_no_conflicts.add(w);
-                set_of_vv_with_one_conflict.remove(w);
-            } else if (num_conflicts[w] == 1) {
-                set_of_vv_with_one_conflict.add(w);
+        for (int e : uncovered_edges.elements) {
+            ++edge_weight[e];
+            ++dscore[edge_endpoints[e].first];
+            ++dscore[edge_endpoints[e].second];
+        }
+        total_edge_weight += uncovered_edges.size();
+
+        if (total_edge_weight > LOCAL_SEARCH_WEIGHT_DECAY_THRESHOLD * g.n * edge_endpoints.size()) {
+            total_edge_weight = 0;
+            for (auto & wt : edge_weight) {
+                wt = std::max(1l, long(wt * LOCAL_SEARCH_WEIGHT_DECAY_FACTOR));
+                total_edge_weight += wt;
             }
+            recalculate_dscores();
         }
     }
 
-    bool permitted_by_tabu_rule(int v)
+    // The vertices outside the cover are an independent set.  Return true if it
+    // is a new incumbent.
+    auto record_independent_set() -> bool
     {
-        return time > last_time_changed[v] + tabu_duration;
+        if (g.n - cover.size() <= incumbent.vv.size())
+            return false;
+        incumbent.clear();
+        for (unsigned v=0; v<g.n; v++)
+            if (!in_cover[v])
+                incumbent.push_vtx(v, 1);
+        if (shared_incumbent)
+            shared_incumbent->raise(incumbent.total_wt, incumbent.vv.size());
+        printf("c incumbent from local search %d\n", int(incumbent.vv.size()));
+        return true;
     }
 
-    void greedily_add_to_is()
+public:
+    // If shared_incumbent is given, it is raised whenever incumbent improves
+    LocalSearcher(const SparseGraph & g, VtxList & incumbent, SharedIncumbent * shared_incumbent = nullptr,
+            unsigned seed = std::mt19937::default_seed)
+            : g(g), incumbent(incumbent), shared_incumbent(shared_incumbent), mt19937(seed), adj_start(g.n + 1), total_edge_weight(0), in_cover(g.n, true), cover(g.n),
+            uncovered_edges(g.num_edges()), dscore(g.n), conf_change(g.n, true), last_moved(g.n),
+            tabu_vertex(-1), step(0), start_time(std::chrono::steady_clock::now()), time_used(0)
     {
-        if (int(set_of_vv_with_no_conflicts.size()) == ind_set_size)
-            return;
+        for (unsigned v=0; v<g.n; v++)
+            adj_start[v + 1] = adj_start[v] + g.degree(v);
+        adj_vertex.resize(adj_start[g.n]);
+        adj_edge.resize(adj_start[g.n]);
+        edge_endpoints.reserve(adj_start[g.n] / 2);
 
-        vector<int> vertices_without_conflict;
-        for (int v : set_of_vv_with_no_conflicts.elements)
-            if (!ind_set[v])
-                vertices_without_conflict.push_back(v);
+        // number each edge when visiting its lower endpoint, and add it to
+        // both endpoints' lists
+        vector<unsigned long long> next_pos(adj_start.begin(), adj_start.end() - 1);
+        for (unsigned v=0; v<g.n; v++) {
+            for (int w : g.neighbours(v)) {
+                if (int(v) < w) {
+                    int e = edge_endpoints.size();
+                    edge_endpoints.push_back({v, w});
+                    adj_vertex[next_pos[v]] = w;
+                    adj_edge[next_pos[v]++] = e;
+                    adj_vertex[next_pos[w]] = v;
+                    adj_edge[next_pos[w]++] = e;
+                }
+            }
+        }
 
-        std::shuffle(vertices_without_conflict.begin(), vertices_without_conflict.end(), mt19937);
+        edge_weight.assign(edge_endpoints.size(), 1);
+        total_edge_weight = edge_endpoints.size();
 
-        for (int v : vertices_without_conflict)
-            if (num_conflicts[v] == 0 && (ind_set_size>=int(incumbent.vv.size()) || permitted_by_tabu_rule(v)))
-                add_to_ind_set(v);
+        for (unsigned v=0; v<g.n; v++)
+            cover.add(v);
 
-        if (ind_set_size > int(incumbent.vv.size())) {
-            incumbent.clear();
-            for (unsigned i=0; i<g.n; i++) {
-                if (ind_set[i]) {
-                    incumbent.push_vtx(i, 1);
-                }
-            }
-            std::cout << "c incumbent from local search " << incumbent.vv.size() << std::endl;
+        // start from a greedy independent set, taking vertices of low degree first
+        vector<int> vv(g.n);
+        for (unsigned v=0; v<g.n; v++)
+            vv[v] = v;
+        std::stable_sort(vv.begin(), vv.end(), [&](int v, int w) { return g.degree(v) < g.degree(w); });
+        for (int v : vv) {
+            bool has_neighbour_outside_cover = false;
+            for (int w : g.neighbours(v))
+                if (!in_cover[w])
+                    has_neighbour_outside_cover = true;
+            if (!has_neighbour_outside_cover)
+                remove_from_cover(v);
         }
+        std::fill(conf_change.begin(), conf_change.end(), true);
+
+        long round_nanoseconds = std::min(std::max(long(g.n) * LOCAL_SEARCH_NANOSECONDS_PER_VERTEX,
+                1000l * LOCAL_SEARCH_MIN_ROUND_MICROSECONDS), 1000l * LOCAL_SEARCH_MAX_ROUND_MICROSECONDS);
+        round_time_limit = std::chrono::nanoseconds(round_nanoseconds);
+    }
+
+    auto get_time_used() const -> Duration
+    {
+        return time_used;
     }
 
-    void do_swap_or_deletion()
+    // True if the search has had less than its share of the time since the
+    // searcher was created
+    bool is_due()
     {
-        vector<int> vertices_with_one_conflict;
+        auto elapsed = std::chrono::steady_clock::now() - start_time;
+        return time_used < elapsed * LOCAL_SEARCH_TIME_SHARE;
+    }
 
-        // occasionally, do a drop even if a swap is possible
-        std::uniform_int_distribution<> distrib0(0, 20);
-        if (distrib0(mt19937)) {
-            for (int v : set_of_vv_with_one_conflict.elements)
-                if (permitted_by_tabu_rule(v))
-                    vertices_with_one_conflict.push_back(v);
+    // Continue from the independent set vv, which becomes the incumbent if it
+    // is larger.  The edge weights are kept.
+    void restart_from(const vector<int> & vv)
+    {
+        for (unsigned v=0; v<g.n; v++)
+            if (!in_cover[v])
+                add_to_cover(v);
+        for (int v : vv)
+            remove_from_cover(v);
+        std::fill(conf_change.begin(), conf_change.end(), true);
+        tabu_vertex = -1;
+
+        if (vv.size() > incumbent.vv.size()) {
+            incumbent.clear();
+            for (int v : vv)
+                incumbent.push_vtx(v, 1);
         }
+    }
 
-        if (vertices_with_one_conflict.empty()) {
-            // do a drop
-            vector<int> vertices_in_is;
-            for (unsigned i=0; i<g.n; i++)
-                if (ind_set[i])
-                    vertices_in_is.push_back(i);
-            if (!vertices_in_is.empty()) {
-                std::uniform_int_distribution<> distrib(0, vertices_in_is.size() - 1);
-                int v = vertices_in_is[distrib(mt19937)];
-                remove_from_ind_set(v);
-            }
-        } else {
-            // do a swap
-            std::uniform_int_distribution<> distrib(0, vertices_with_one_conflict.size() - 1);
-            int v = vertices_with_one_conflict[distrib(mt19937)];
-            for (int w : g.adjlist[v]) {
-                if (ind_set[w]) {
-                    remove_from_ind_set(w);
-                    add_to_ind_set(v);
+    // Search until round_time_limit has passed without a new incumbent, or
+    // until *stop is set, continuing from where the last call left off
+    void search(const std::atomic<bool> * stop = nullptr)
+    {
+        auto round_start = std::chrono::steady_clock::now();
+        auto deadline = round_start + round_time_limit;
+        for (;;) {
+            if (uncovered_edges.size() == 0) {
+                if (record_independent_set())
+                    deadline = std::chrono::steady_clock::now() + round_time_limit;
+                if (cover.size() == 0)
                     break;
-                }
+                tabu_vertex = -1;
+                remove_from_cover(choose_vertex_to_remove());
+                continue;
             }
+
+            ++step;
+            if (step % LOCAL_SEARCH_STEPS_PER_CLOCK_CHECK == 0 &&
+                    (std::chrono::steady_clock::now() >= deadline || (stop && stop->load(std::memory_order_relaxed))))
+                break;
+
+            if (cover.size() != 0)
+                remove_from_cover(choose_vertex_to_remove());
+            int v = choose_vertex_to_add();
+            add_to_cover(v);
+            tabu_vertex = v;
+            increase_weights_of_uncovered_edges();
         }
+        time_used += std::chrono::steady_clock::now() - round_start;
     }
+};
+
+// Local searchers that run on threads of their own for as long as the clique
+// search of a component.  Each searcher has its own best independent set, and
+// raises the shared incumbent as soon as it improves.  The clique search hands
+// its improvements back with seed(), and a searcher whose best set is smaller
+// than the seed continues from it.
+class LocalSearchThreads
+{
+    struct Walker
+    {
+        VtxList best;
+        LocalSearcher searcher;
+
+        Walker(const SparseGraph & g, SharedIncumbent & shared_incumbent, unsigned seed)
+                : best(g.n), searcher(g, best, &shared_incumbent, seed)
+        {
+        }
+    };
+
+    const SparseGraph & g;
+    SharedIncumbent & shared_incumbent;
+    vector<std::unique_ptr<Walker>> walkers;
+    vector<std::thread> threads;
+    std::atomic<bool> stop;
+
+    // seed_vv is protected by seed_mutex; seed_version is incremented each
+    // time it changes, so that walkers can poll it without locking
+    std::mutex seed_mutex;
+    vector<int> seed_vv;
+    std::atomic<unsigned> seed_version;
 
-    void search()
+    // Each walker is built on its own thread, so that building the searchers'
+    // edge lists doesn't hold up the clique search
+    auto run_walker(int i) -> void
     {
-        unsigned long long local_time = 0;
-        int local_best = 0;
-        while (local_time < local_time_limit) {
-            greedily_add_to_is();
-            do_swap_or_deletion();
-            do_swap_or_deletion();
-            if (ind_set_size > local_best) {
-                local_best = ind_set_size;
-                local_time = 0;
+        walkers[i] = std::make_unique<Walker>(g, shared_incumbent, i + 1);
+        Walker & w = *walkers[i];
+        unsigned version = 0;
+        while (!stop) {
+            unsigned latest_version = seed_version;
+            if (latest_version != version) {
+                version = latest_version;
+                std::lock_guard<std::mutex> lock(seed_mutex);
+                if (seed_vv.size() > w.best.vv.size())
+                    w.searcher.restart_from(seed_vv);
             }
-            ++local_time;
-            ++time;
-//            if (0 == (time % 100000)) {
-//                std::cout << "c time " << time << std::endl;
-//            }
+            w.searcher.search(&stop);
         }
-        local_time_limit = local_time_limit + local_time_limit / 1000;
-        reset();
+    }
+
+public:
+    // Start num_threads searchers, each beginning from initial_incumbent, an
+    // independent set of g
+    LocalSearchThreads(const SparseGraph & g, SharedIncumbent & shared_incumbent,
+            const VtxList & initial_incumbent, int num_threads)
+            : g(g), shared_incumbent(shared_incumbent), walkers(num_threads), stop(false),
+              seed_vv(initial_incumbent.vv), seed_version(1)
+    {
+        for (int i=0; i<num_threads; i++)
+            threads.emplace_back([this, i]() { run_walker(i); });
+    }
+
+    ~LocalSearchThreads()
+    {
+        finish();
+    }
+
+    // Offer a new incumbent, an independent set of g, to the searchers
+    auto seed(const vector<int> & vv) -> void
+    {
+        std::lock_guard<std::mutex> lock(seed_mutex);
+        seed_vv = vv;
+        ++seed_version;
+    }
+
+    // Stop the searchers and wait for them
+    auto finish() -> void
+    {
+        stop = true;
+        for (auto & thread : threads)
+            thread.join();
+        threads.clear();
+    }
+
+    // Replace incumbent with the best searcher's independent set if it is
+    // larger.  Precondition: finish() has been called.
+    auto take_best(VtxList & incumbent) -> void
+    {
+        for (auto & w : walkers)
+            if (w->best.total_wt > incumbent.total_wt)
+                incumbent = w->best;
     }
 };
 
+// Nodes at depths less than this are split into one task per child when
+// searching in parallel, so that other threads can steal them
+#define PARALLEL_SPLIT_DEPTH 3
+
+// A subproblem that is waiting to be expanded
+struct SearchTask
+{
+    VtxList C;
+    vector<unsigned long long> P_bitset;
+
+    SearchTask() : C(0) {}
+    SearchTask(const VtxList & C, int numwords) : C(C), P_bitset(numwords) {}
+};
+
+// The state belonging to one search thread.  Each worker has its own colourer
+// (and hence its own unit propagator) and scratch bitsets, and a deque of
+// tasks.  The owner pushes and pops tasks at the back of its deque; other
+// workers steal from the front, where the shallowest tasks are.
+struct MWCWorker
+{
+    int id;
+    std::shared_ptr<Colourer> colourer;
+    vector<vector<unsigned long long>> branch_vv_bitsets;
+    vector<vector<unsigned long long>> new_P_bitsets;
+    std::atomic<long> search_node_count;    // only written by this worker
+    Duration colouring_time {};    // in colouring_bound, if params.collect_stats is set
+    std::deque<SearchTask> tasks;
+    std::mutex tasks_mutex;
+    std::mt19937 rng;
+
+    MWCWorker(int id, Graph & g, const Params & params)
+            : id(id), colourer(Colourer::create_colourer(g, params)), branch_vv_bitsets(g.n),
+              new_P_bitsets(g.n), search_node_count(0), rng(id)
+    {
+    }
+};
+
+// The clique search.  Words is the number of words in g's bitsets, or 0 if
+// that is greater than MAX_FIXED_NUM_WORDS, so that the bitset loops of the
+// search are unrolled for small graphs.
+template<int Words>
 class MWC {
     Graph & g;
     const Params params;
-    Colourer & colourer;
     VtxList & incumbent;
-    vector<vector<unsigned long long>> branch_vv_bitsets;
-    vector<vector<unsigned long long>> new_P_bitsets;
     const vector<int> & vertex_numbers_in_original_graph;
     LocalSearcher & local_searcher;
+    LocalSearchThreads * local_search_threads;    // null if the local search is run by worker 0
     ColouringNumberFinder & exact_colourer1;
     ColouringNumberFinder & exact_colourer2;
 
+    // incumbent is only modified while incumbent_mutex is held.  Its weight
+    // and size are mirrored in shared_incumbent so that workers can prune
+    // without locking.  The local search threads also raise shared_incumbent,
+    // so it may be ahead of incumbent.
+    std::mutex incumbent_mutex;
+    SharedIncumbent & shared_incumbent;
+
+    // set when the incumbent has been proved optimal, or within the allowed gap
+    std::atomic<bool> search_finished;
+
+    // an upper bound on the weight of an independent set, if one of the
+    // colouring number finders has ended the search; otherwise -1
+    long colouring_bound_of_g;
+    const char * closed_by;
+
+    // the time worker 0 has spent in the colouring number finders
+    Duration colouring_number_time {};
+
+    // the total search node count at which worker 0 next asks whether the
+    // local search is due, since that reads the clock
+    long next_local_search_check;
+
+    // the number of tasks that have been created but have not finished
+    std::atomic<long> num_unfinished_tasks;
+
+    vector<std::unique_ptr<MWCWorker>> workers;
+    int split_depth;
+
+    auto num_words() const -> int
+    {
+        return Words ? Words : g.numwords;
+    }
+
+    // Precondition: incumbent_mutex is held
+    auto publish_incumbent() -> void
+    {
+        shared_incumbent.raise(incumbent.total_wt, incumbent.vv.size());
+    }
+
     auto update_incumbent_if_necessary(VtxList & C)
     {
-        if (C.total_wt > incumbent.total_wt) {
-            incumbent = C;
+        if (C.total_wt > shared_incumbent.wt) {
+            std::lock_guard<std::mutex> lock(incumbent_mutex);
+            if (C.total_wt > incumbent.total_wt) {
+                incumbent = C;
+
+                for (unsigned i=0; i<incumbent.vv.size(); i++)
+                    incumbent.vv[i] = vertex_numbers_in_original_graph[incumbent.vv[i]];
+
+                publish_incumbent();
+                if (local_search_threads)
+                    local_search_threads->seed(incumbent.vv);
+                printf("c TMP %ld\n", incumbent.total_wt);
+            }
+        }
+    }
+
+    auto total_search_node_count() -> long
+    {
+        long total = 0;
+        for (auto & w : workers)
+            total += w->search_node_count.load(std::memory_order_relaxed);
+        return total;
+    }
 
-            for (unsigned i=0; i<incumbent.vv.size(); i++)
-                incumbent.vv[i] = vertex_numbers_in_original_graph[incumbent.vv[i]];
+    // Run the local search and the colouring number finders if they are due, and
+    // return true if the incumbent has been proved optimal, or within the
+    // allowed gap.  The searchers are not thread-safe, so only worker 0 calls
+    // this.  The local search gets a fixed share of the time on graphs of more
+    // than 30 vertices, and the colouring number finders are scheduled
+    // according to the number of nodes searched by all workers.
+    auto run_auxiliary_searches() -> bool
+    {
+        long search_node_count = total_search_node_count();
+        if (g.n > 30 && !local_search_threads && search_node_count >= next_local_search_check) {
+            next_local_search_check = search_node_count + LOCAL_SEARCH_NODES_PER_DUE_CHECK;
+            if (local_searcher.is_due()) {
+                std::lock_guard<std::mutex> lock(incumbent_mutex);
+                local_searcher.search(&aborted);
+                publish_incumbent();
+            }
+        }
+        if (search_node_count > exact_colourer1.get_search_node_count() * 50) {
+            auto start = std::chrono::steady_clock::now();
+            exact_colourer1.search(&aborted);
+            colouring_number_time += std::chrono::steady_clock::now() - start;
+        }
+        int size = shared_incumbent.size;
+        long slack = allowed_gap(params, g.n, size);
+        int colouring_num = exact_colourer1.get_colouring_number();
+        if (colouring_num != -1 && size + slack >= colouring_num) {
+            colouring_bound_of_g = colouring_num;
+            closed_by = "colouring number";
+            return true;
+        }
+        if (exact_colourer1.get_colouring_number() != -1 &&
+                search_node_count > exact_colourer2.get_search_node_count() * 1000) {
+            auto start = std::chrono::steady_clock::now();
+            exact_colourer2.search(&aborted);
+            colouring_number_time += std::chrono::steady_clock::now() - start;
+        }
+        int fractional_colouring_num = exact_colourer2.get_colouring_number();
+        if (fractional_colouring_num != -1) {
+            int fractional_colouring_bound = fractional_colouring_num / 2;
+            if (size + slack >= fractional_colouring_bound) {
+                colouring_bound_of_g = fractional_colouring_bound;
+                closed_by = "fractional colouring number";
+                return true;
+            }
+        }
+        return false;
+    }
 
-            std::cout << "c TMP " << incumbent.total_wt << std::endl;
+    // Make a task for each child of the current node, and push them in reverse
+    // order so that the owner pops them in the order that expand() would visit them
+    auto spawn_children(MWCWorker & w, VtxList& C, vector<unsigned long long> & P_bitset,
+            vector<unsigned long long> & branch_vv_bitset) -> void
+    {
+        vector<SearchTask> children;
+        int v;
+        int first_word = 0;
+        while ((v=first_set_bit(branch_vv_bitset, first_word, num_words()))!=-1) {
+            first_word = v / BITS_PER_WORD;
+            unset_bit(branch_vv_bitset, v);
+            children.emplace_back(C, num_words());
+            bitset_intersection_with_complement(P_bitset, g.bit_complement_nd[v],
+                    children.back().P_bitset, num_words());
+            children.back().C.push_vtx(v, g);
+            set_bit(P_bitset, v);
         }
+
+        num_unfinished_tasks += children.size();
+        std::lock_guard<std::mutex> lock(w.tasks_mutex);
+        for (auto it=children.rbegin(); it!=children.rend(); ++it)
+            w.tasks.push_back(std::move(*it));
     }
 
-    void expand(VtxList& C, vector<unsigned long long> & P_bitset, long & search_node_count)
+    void expand(MWCWorker & w, VtxList& C, vector<unsigned long long> & P_bitset)
     {
-        ++search_node_count;
-        if (bitset_empty(P_bitset, g.numwords)) {
+        w.search_node_count.store(w.search_node_count.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+        if (search_finished.load(std::memory_order_relaxed) || aborted.load(std::memory_order_relaxed))
+            return;
+        if (bitset_empty(P_bitset, num_words())) {
             update_incumbent_if_necessary(C);
             return;
         }
 
-        if (g.n > 30) {
-            if (search_node_count > local_searcher.get_time()) {
-                local_searcher.search();
-            }
-            if (search_node_count > exact_colourer1.get_search_node_count() * 50) {
-                exact_colourer1.search();
-            }
-            int colouring_num = exact_colourer1.get_colouring_number();
-            if (colouring_num != -1 && int(incumbent.vv.size()) == colouring_num) {
-                return;
-            }
-            if (exact_colourer1.get_colouring_number() != -1 &&
-                    search_node_count > exact_colourer2.get_search_node_count() * 1000) {
-                exact_colourer2.search();
-            }
-            int fractional_colouring_num = exact_colourer2.get_colouring_number();
-            if (fractional_colouring_num != -1) {
-                int fractional_colouring_bound = fractional_colouring_num / 2;
-                if (int(incumbent.vv.size()) == fractional_colouring_bound) {
-                    return;
-                }
-            }
+        if (w.id == 0 && run_auxiliary_searches()) {
+            search_finished = true;
+            return;
         }
 
-        vector<unsigned long long> & branch_vv_bitset = branch_vv_bitsets[C.vv.size()];
+        vector<unsigned long long> & branch_vv_bitset = w.branch_vv_bitsets[C.vv.size()];
         if (branch_vv_bitset.empty())
-            branch_vv_bitset.resize(g.numwords);
+            branch_vv_bitset.resize(num_words());
         else
             std::fill(branch_vv_bitset.begin(), branch_vv_bitset.end(), 0);
 
-        long target = incumbent.total_wt - C.total_wt;
-        if (colourer.colouring_bound(P_bitset, branch_vv_bitset, target)) {
-            vector<unsigned long long> & new_P_bitset = new_P_bitsets[C.vv.size()];
-            if (new_P_bitset.empty())
-                new_P_bitset.resize(g.numwords);
+        // a branch is pruned unless it could beat the incumbent by more than
+        // the allowed gap
+        long incumbent_wt = shared_incumbent.wt.load(std::memory_order_relaxed);
+        long target = incumbent_wt + allowed_gap(params, g.n, incumbent_wt) - C.total_wt;
+        auto colouring_start = params.collect_stats ? std::chrono::steady_clock::now()
+                                                    : std::chrono::steady_clock::time_point();
+        bool must_branch = w.colourer->colouring_bound(P_bitset, branch_vv_bitset, target);
+        if (params.collect_stats)
+            w.colouring_time += std::chrono::steady_clock::now() - colouring_start;
+        if (must_branch) {
+            bitset_intersect_with_complement(P_bitset, branch_vv_bitset, num_words());
 
-            bitset_intersect_with_complement(P_bitset, branch_vv_bitset, g.numwords);
+            if (int(C.vv.size()) < split_depth) {
+                spawn_children(w, C, P_bitset, branch_vv_bitset);
+                return;
+            }
+
+            vector<unsigned long long> & new_P_bitset = w.new_P_bitsets[C.vv.size()];
+            if (new_P_bitset.empty())
+                new_P_bitset.resize(num_words());
 
             int v;
-            while ((v=first_set_bit(branch_vv_bitset, g.numwords))!=-1) {
+            int first_word = 0;
+            while ((v=first_set_bit(branch_vv_bitset, first_word, num_words()))!=-1) {
+                first_word = v / BITS_PER_WORD;
                 unset_bit(branch_vv_bitset, v);
-                bitset_intersection_with_complement(P_bitset, g.bit_complement_nd[v], new_P_bitset, g.numwords);
+                bitset_intersection_with_complement(P_bitset, g.bit_complement_nd[v], new_P_bitset, num_words());
                 C.push_vtx(v, g);
-                expand(C, new_P_bitset, search_node_count);
+                expand(w, C, new_P_bitset);
                 set_bit(P_bitset, v);
                 C.pop_vtx(g);
             }
         }
     }
 
+    auto pop_task(MWCWorker & w, SearchTask & task) -> bool
+    {
+        std::lock_guard<std::mutex> lock(w.tasks_mutex);
+        if (w.tasks.empty())
+            return false;
+        task = std::move(w.tasks.back());
+        w.tasks.pop_back();
+        return true;
+    }
+
+    // Try each other worker in turn, starting from a random one
+    auto steal_task(MWCWorker & w, SearchTask & task) -> bool
+    {
+        int num_workers = workers.size();
+        int start = std::uniform_int_distribution<int>(0, num_workers - 1)(w.rng);
+        for (int i=0; i<num_workers; i++) {
+            MWCWorker & victim = *workers[(start + i) % num_workers];
+            if (&victim == &w)
+                continue;
+            std::lock_guard<std::mutex> lock(victim.tasks_mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    auto run_worker(MWCWorker & w) -> void
+    {
+        SearchTask task;
+        while (!search_finished && num_unfinished_tasks > 0) {
+            if (pop_task(w, task) || steal_task(w, task)) {
+                expand(w, task.C, task.P_bitset);
+                --num_unfinished_tasks;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
 public:
-    MWC(Graph & g, const Params params, VtxList & incumbent, Colourer & colourer,
+    MWC(Graph & g, const Params params, VtxList & incumbent,
             const vector<int> & vertex_numbers_in_original_graph, LocalSearcher & local_searcher,
-            ColouringNumberFinder & exact_colourer1, ColouringNumberFinder & exact_colourer2)
-            : g(g), params(params), colourer(colourer), incumbent(incumbent), branch_vv_bitsets(g.n), new_P_bitsets(g.n),
+            LocalSearchThreads * local_search_threads, ColouringNumberFinder & exact_colourer1,
+            ColouringNumberFinder & exact_colourer2, SharedIncumbent & shared_incumbent, int num_workers)
+            : g(g), params(params), incumbent(incumbent),
               vertex_numbers_in_original_graph(vertex_numbers_in_original_graph), local_searcher(local_searcher),
-              exact_colourer1(exact_colourer1), exact_colourer2(exact_colourer2)
+              local_search_threads(local_search_threads), exact_colourer1(exact_colourer1),
+              exact_colourer2(exact_colourer2), shared_incumbent(shared_incumbent),
+              search_finished(false), colouring_bound_of_g(-1), closed_by("search"), next_local_search_check(0),
+              num_unfinished_tasks(0),
+              split_depth(num_workers > 1 ? PARALLEL_SPLIT_DEPTH : 0)
+    {
+        for (int i=0; i<num_workers; i++)
+            workers.push_back(std::make_unique<MWCWorker>(i, g, params));
+    }
+
+    auto run(VtxList & C) -> void
+    {
+        workers[0]->tasks.emplace_back(C, num_words());
+        set_first_n_bits(workers[0]->tasks.back().P_bitset, g.n);
+        num_unfinished_tasks = 1;
+
+        vector<std::thread> threads;
+        for (unsigned i=1; i<workers.size(); i++)
+            threads.emplace_back([this, i]() { run_worker(*workers[i]); });
+        run_worker(*workers[0]);
+        for (auto & thread : threads)
+            thread.join();
+    }
+
+    auto get_search_node_count(int worker_id) -> long
+    {
+        return workers[worker_id]->search_node_count;
+    }
+
+    auto get_colouring_bound() -> long
     {
+        return colouring_bound_of_g;
     }
 
-    auto run(VtxList & C, long & search_node_count) -> void
+    // Add the workers' node counts and times to stats, and say what ended the
+    // search.  The local search time is added by the caller.
+    auto record_stats(ComponentStats & stats) -> void
     {
-        vector<unsigned long long> P_bitset(g.numwords, 0);
-        set_first_n_bits(P_bitset, g.n);
-        expand(C, P_bitset, search_node_count);
+        for (auto & w : workers) {
+            stats.search_node_count += w->search_node_count;
+            Duration unit_propagation_time = w->colourer->unit_propagation_time();
+            stats.colouring_time += w->colouring_time - unit_propagation_time;
+            stats.unit_propagation_time += unit_propagation_time;
+        }
+        stats.colouring_number_time += colouring_number_time;
+        stats.closed_by = closed_by;
     }
 };
 
-auto sequential_mwc(const SparseGraph & g, const Params params, VtxList & incumbent, long & search_node_count) -> void
+// An upper bound on the size of an independent set of g: n minus the size of a
+// maximal matching
+static auto matching_bound(const SparseGraph & g) -> int
+{
+    vector<bool> matched(g.n);
+    int num_matched_edges = 0;
+    for (unsigned v=0; v<g.n; v++) {
+        if (matched[v])
+            continue;
+        for (int w : g.neighbours(v)) {
+            if (!matched[w]) {
+                matched[v] = true;
+                matched[w] = true;
+                ++num_matched_edges;
+                break;
+            }
+        }
+    }
+    return g.n - num_matched_edges;
+}
+
+// An upper bound on the size of an independent set of g: the number of cliques
+// in a greedy cover of g by cliques, with vertices of low degree first
+static auto clique_cover_bound(const SparseGraph & g) -> int
+{
+    vector<int> vv(g.n);
+    for (unsigned v=0; v<g.n; v++)
+        vv[v] = v;
+    std::stable_sort(vv.begin(), vv.end(), [&](int v, int w) { return g.degree(v) < g.degree(w); });
+    return GreedyCliqueCover(g.n).count_cliques(g, vv, [](int) { return true; });
+}
+
+// An upper bound on the size of an independent set of g: n minus the LP lower
+// bound on the size of a vertex cover
+static auto lp_bound(const SparseGraph & g) -> int
+{
+    vector<int> zero_vv;
+    vector<int> one_vv;
+    return g.n - LpRelaxation(g.n).solve(g, vector<bool>(g.n), zero_vv, one_vv);
+}
+
+// Return the first of the cheap upper bounds on the size of an independent set
+// of g, trying the cheapest first, that shows that incumbent is within slack
+// of a maximum independent set, and put its name in closed_by; or return -1
+// if none of them does
+static auto bound_met_by_incumbent(const SparseGraph & g, const VtxList & incumbent, long slack,
+        const char * & closed_by) -> int
+{
+    long size = incumbent.vv.size();
+    int bound;
+    const char * name = size + slack >= (bound = matching_bound(g)) ? "matching bound" :
+                        size + slack >= (bound = clique_cover_bound(g)) ? "clique cover bound" :
+                        size + slack >= (bound = lp_bound(g)) ? "LP bound" : nullptr;
+    if (!name)
+        return -1;
+    printf("c component of %u vertices closed by the %s\n", g.n, name);
+    closed_by = name;
+    return bound;
+}
+
+static auto search_component(const SparseGraph & g, const Params params, VtxList & incumbent, LocalSearcher & ls,
+        ComponentStats & stats) -> int
 {
     VtxList C(g.n);
 
-    LocalSearcher ls(g, incumbent);
-    if (g.n > 30)  // don't bother with local search for very small graphs
-        for (int i=0; i<10; i++)
-            ls.search();
+    if (g.n > 30) {  // don't bother with local search for very small graphs
+        for (int i=0; i<10 && !aborted; i++)
+            ls.search(&aborted);
+
+        // skip the colouring setup and the search if the local search has
+        // already found an optimal solution, or one within the allowed gap
+        int bound = bound_met_by_incumbent(g, incumbent, allowed_gap(params, g.n, incumbent.vv.size()),
+                stats.closed_by);
+        if (bound != -1)
+            return bound;
+    }
+
+    // Out of time: settle for the local search's independent set, which is
+    // recorded as soon as the search starts
+    if (aborted) {
+        ls.search(&aborted);
+        stats.closed_by = "aborted";
+        return lp_bound(g);
+    }
+
+    if (params.algorithm_num == 6) {
+        vector<int> cover;
+        if (branch_and_reduce_vertex_cover(g, params.reduce_interval, g.n - incumbent.vv.size(), cover,
+                    stats.search_node_count)) {
+            vector<bool> in_cover(g.n);
+            for (int v : cover)
+                in_cover[v] = true;
+            incumbent.clear();
+            for (unsigned v=0; v<g.n; v++)
+                if (!in_cover[v])
+                    incumbent.push_vtx(v, 1);
+        }
+        stats.closed_by = aborted ? "aborted" : "branch and reduce";
+        return aborted ? lp_bound(g) : incumbent.vv.size();
+    }
 
     ColouringGraph cg(g.n);
     for (unsigned v=0; v<g.n; v++)
-        for (int w : g.adjlist[v])
+        for (int w : g.neighbours(v))
             if (int(v) < w)
                 cg.add_edge(v, w);
 
@@ -347,8 +982,53 @@ auto sequential_mwc(const SparseGraph & g, const Params params, VtxList & incumb
     for (unsigned i=0; i<ordered_graph.n; i++)
         vv1.push_back(i);
     Graph ordered_subgraph = ordered_graph.complement_of_induced_subgraph(vv1);
-    std::shared_ptr<Colourer> colourer = Colourer::create_colourer(ordered_subgraph, params);
 
-    MWC(ordered_subgraph, params, incumbent, *colourer, vv0, ls, exact_colourer1, exact_colourer2).run(
-            C, search_node_count);
+    // algorithm 5 searches each component in parallel; small components aren't worth it
+    int num_workers = params.algorithm_num == 5 && g.n > 30 ? params.num_threads : 1;
+
+    SharedIncumbent shared_incumbent(incumbent.total_wt, incumbent.vv.size());
+    std::unique_ptr<LocalSearchThreads> local_search_threads;
+    if (params.local_search_threads > 0 && g.n > 30)
+        local_search_threads = std::make_unique<LocalSearchThreads>(g, shared_incumbent, incumbent,
+                params.local_search_threads);
+
+    vector<long> worker_search_node_counts(num_workers);
+    long colouring_bound = -1;
+    dispatch_on_num_words(ordered_subgraph.numwords, [&](auto words) {
+        MWC<decltype(words)::value> mwc(ordered_subgraph, params, incumbent, vv0, ls, local_search_threads.get(),
+                exact_colourer1, exact_colourer2, shared_incumbent, num_workers);
+        mwc.run(C);
+        for (int i=0; i<num_workers; i++)
+            worker_search_node_counts[i] = mwc.get_search_node_count(i);
+        colouring_bound = mwc.get_colouring_bound();
+        mwc.record_stats(stats);
+    });
+
+    if (local_search_threads) {
+        local_search_threads->finish();
+        local_search_threads->take_best(incumbent);
+    }
+
+    if (num_workers > 1)
+        for (int i=0; i<num_workers; i++)
+            printf("c worker %d search nodes %ld\n", i, worker_search_node_counts[i]);
+
+    // The search prunes each branch that can't beat the incumbent by more than
+    // the allowed gap.  The incumbent's weight plus the gap only grows as the
+    // incumbent improves, so the final value bounds every branch.
+    if (colouring_bound != -1)
+        return colouring_bound;
+    if (aborted) {
+        stats.closed_by = "aborted";
+        return lp_bound(g);
+    }
+    return incumbent.vv.size() + allowed_gap(params, g.n, incumbent.vv.size());
+}
+
+auto sequential_mwc(const SparseGraph & g, const Params params, VtxList & incumbent, ComponentStats & stats) -> int
+{
+    LocalSearcher ls(g, incumbent);
+    int bound = search_component(g, params, incumbent, ls, stats);
+    stats.local_search_time += ls.get_time_used();
+    return bound;
 }
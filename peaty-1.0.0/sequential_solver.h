@@ -4,9 +4,14 @@
 #include "sparse_graph.h"
 #include "graph.h"
 #include "params.h"
+#include "stats.h"
 
 #include <atomic>
 
-auto sequential_mwc(const SparseGraph & g, const Params params, VtxList & incumbent, long & search_node_count) -> void;
+// Find a maximum independent set of g, or one within params' gap of the
+// maximum, and put it in incumbent.  Return an upper bound on the size of an
+// independent set of g: the size of incumbent if it was proved maximum.  The
+// search's node count and times are added to stats.
+auto sequential_mwc(const SparseGraph & g, const Params params, VtxList & incumbent, ComponentStats & stats) -> int;
 
 #endif
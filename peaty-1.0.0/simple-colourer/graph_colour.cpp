@@ -2,8 +2,10 @@
 
 #include "../graph_colour_solver.h"
 
+#include <chrono>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <argp.h>
@@ -23,18 +25,21 @@ static char args_doc[] = "FILENAME";
 static struct argp_option options[] = {
     {"fractional-level", 'f', "LEVEL", 0, "1 for colouring, 2 for two colours per vertex, etc"},
     {"time-limit", 'l', "LIMIT", 0, "Time limit in milliseconds"},
+    {"threads", 't', "THREADS", 0, "Number of threads in the randomised restart portfolio"},
     { 0 }
 };
 
 static struct {
     int fractional_level;
     int time_limit;
+    int num_threads;
     int arg_num;
 } arguments;
 
 void set_default_arguments() {
     arguments.fractional_level = 1;
     arguments.time_limit = 0;
+    arguments.num_threads = 1;
     arguments.arg_num = 0;
 }
 
@@ -46,6 +51,9 @@ static error_t parse_opt (int key, char *arg, struct argp_state *state) {
         case 'l':
             arguments.time_limit = atoi(arg);
             break;
+        case 't':
+            arguments.num_threads = atoi(arg);
+            break;
         case ARGP_KEY_ARG:
             argp_usage(state);
             break;
@@ -108,14 +116,26 @@ int main(int argc, char** argv)
     struct ColouringGraph complement_g(g.n);
     for (int i=0; i<g.n; i++) {
         for (int j=i+1; j<g.n; j++) {
-            if (!g.adj_matrix[i][j]) {
+            if (!g.has_edge(i, j)) {
                 complement_g.add_edge(i, j);
             }
         }
     }
 
-    std::atomic_bool terminate_early(false);
-    int colouring_number = find_colouring_number(complement_g, arguments.fractional_level, terminate_early);
+    // static, since the timer thread may still be sleeping when main returns
+    static std::atomic_bool terminate_early(false);
+    if (arguments.time_limit > 0) {
+        std::thread([]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(arguments.time_limit));
+            terminate_early = true;
+        }).detach();
+    }
+
+    int colouring_number = find_colouring_number(complement_g, arguments.fractional_level, terminate_early,
+            arguments.num_threads);
 
-    printf("%d-fold colouring number is %d\n", arguments.fractional_level, colouring_number);
+    if (colouring_number == -1)
+        printf("Time limit reached\n");
+    else
+        printf("%d-fold colouring number is %d\n", arguments.fractional_level, colouring_number);
 }
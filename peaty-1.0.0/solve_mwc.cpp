@@ -1,22 +1,29 @@
 #define _POSIX_SOURCE
 
 #include <argp.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <functional>
 #include <mutex>
+#include <string>
+#include <thread>
 
 #include "graph.h"
+#include "csr_snapshot.h"
 #include "sparse_graph.h"
 #include "util.h"
 #include "sequential_solver.h"
 #include "params.h"
+#include "reductions.h"
+#include "stats.h"
 
 using std::atomic;
 using std::condition_variable;
@@ -36,18 +43,28 @@ static char args_doc[] = "";
 static struct argp_option options[] = {
     {"quiet", 'q', 0, 0, "Quiet output"},
     {"unweighted-sort", 'u', 0, 0, "Unweighted ordering (only applies to certain algorithms)"},
-    {"colouring-variant", 'c', "VARIANT", 0, "For algorithms 0 and 5, which type of colouring?"},
-    {"algorithm", 'a', "NUMBER", 0, "Algorithm number"},
+    {"colouring-variant", 'c', "VARIANT", 0, "For algorithms 0 and 5, which type of colouring? (4 = build bounds incrementally from ancestor nodes' colourings)"},
+    {"algorithm", 'a', "NUMBER", 0, "Algorithm number (5 = parallel search within each component, 6 = branch and reduce, which can be much slower than the default: it takes 35 s on vc-exact_035 and does not finish vc-exact_031 in 100 s, where the default takes 1 s)"},
     {"max-sat-level", 'm', "LEVEL", 0, "Level of MAXSAT reasoning; default=2"},
-    {"num-threads", 't', "NUMBER", 0, "Number of threads (for parallel algorithms only)"},
-    {"file-format", 'f', "FORMAT", 0, "File format (DIMACS, MTX or EDGES)"},
+    {"num-threads", 't', "NUMBER", 0, "Number of threads for solving components (or, with algorithm 5, searching each component) in parallel"},
+    {"file-format", 'f', "FORMAT", 0, "File format (PACE, DIMACS or CSR, a binary snapshot written by --write-csr)"},
+    {"check-integrity", 'i', 0, 0, "Check the adjacency lists after kernelization (for debugging)"},
+    {"bitset-propagation", 'b', 0, 0, "Use word-parallel unit propagation over clause bitsets"},
+    {"write-csr", 'w', "FILE", 0, "Write the input graph to FILE as a binary CSR snapshot, then exit"},
+    {"reductions", 'r', "RULES", 0, "Comma-separated list of the optional reduction rules to apply (lp, unconfined, twin, or none); default=lp,unconfined,twin"},
+    {"reduce-interval", 'd', "DEPTH", 0, "With algorithm 6, apply the reduction rules at every DEPTH-th level of the search tree; default=1"},
+    {"gap", 'g', "GAP", 0, "Accept a vertex cover of each component that is up to GAP vertices, or GAP percent if GAP ends with %, larger than the minimum"},
+    {"time-limit", 'T', "SECONDS", 0, "Stop searching after SECONDS (or on SIGTERM) and print the best vertex cover found so far"},
+    {"stats", 's', "FORMAT", 0, "Write statistics for each phase, reduction rule and component to standard error at the end (FORMAT must be json)"},
+    {"local-search-threads", 'l', "NUMBER", 0, "Number of threads running local search alongside the search of each component; default=0 (interleave it with the search)"},
     { 0 }
 };
 
 enum class FileFormat
 {
     Dimacs,
-    Pace
+    Pace,
+    CsrSnapshot
 };
 
 static struct {
@@ -58,8 +75,41 @@ static struct {
     int max_sat_level = -1;
     int num_threads = 1;
     FileFormat file_format = FileFormat::Pace;
+    bool check_integrity = false;
+    bool bitset_unit_propagation = false;
+    const char * csr_snapshot_filename = nullptr;
+    int local_search_threads = 0;
+    int reduce_interval = 1;
+    unsigned time_limit = 0;
+    int absolute_gap = 0;
+    double relative_gap = 0;
+    bool stats = false;
+    KernelizerOptions kernelizer_options;
 } arguments;
 
+// Switch on the reduction rules named in a comma-separated list, and switch
+// off the rest
+static auto parse_reduction_rules(const char * arg) -> void
+{
+    auto & options = arguments.kernelizer_options;
+    options.lp = options.unconfined = options.twin = false;
+    std::string rules(arg);
+    size_t begin = 0;
+    while (begin <= rules.size()) {
+        size_t end = std::min(rules.find(',', begin), rules.size());
+        std::string rule = rules.substr(begin, end - begin);
+        if (rule == "lp")
+            options.lp = true;
+        else if (rule == "unconfined")
+            options.unconfined = true;
+        else if (rule == "twin")
+            options.twin = true;
+        else if (rule != "none" && rule != "")
+            fail("Unknown reduction rule.");
+        begin = end + 1;
+    }
+}
+
 static error_t parse_opt (int key, char *arg, struct argp_state *state)
 {
     switch (key) {
@@ -86,6 +136,41 @@ static error_t parse_opt (int key, char *arg, struct argp_state *state)
                 arguments.file_format = FileFormat::Pace;
             else if (!strcmp(arg, "DIMACS") || !strcmp(arg, "dimacs"))
                 arguments.file_format = FileFormat::Dimacs;
+            else if (!strcmp(arg, "CSR") || !strcmp(arg, "csr"))
+                arguments.file_format = FileFormat::CsrSnapshot;
+            break;
+        case 'i':
+            arguments.check_integrity = true;
+            break;
+        case 'b':
+            arguments.bitset_unit_propagation = true;
+            break;
+        case 'w':
+            arguments.csr_snapshot_filename = arg;
+            break;
+        case 'l':
+            arguments.local_search_threads = atoi(arg);
+            break;
+        case 'r':
+            parse_reduction_rules(arg);
+            break;
+        case 'd':
+            arguments.reduce_interval = atoi(arg);
+            break;
+        case 'T':
+            arguments.time_limit = atoi(arg);
+            break;
+        case 's':
+            if (strcmp(arg, "json"))
+                fail("The only statistics format is json.");
+            arguments.stats = true;
+            arguments.kernelizer_options.collect_stats = true;
+            break;
+        case 'g':
+            if (arg[0] && arg[strlen(arg) - 1] == '%')
+                arguments.relative_gap = atof(arg) / 100;
+            else
+                arguments.absolute_gap = atoi(arg);
             break;
         case ARGP_KEY_ARG:
 //            argp_usage(state);
@@ -116,7 +201,7 @@ bool check_vertex_cover(const SparseGraph & g, const vector<int> & vc) {
     }
     for (unsigned i=0; i<g.n; i++) {
         if (!in_vc[i]) {
-            for (unsigned v : g.adjlist[i]) {
+            for (unsigned v : g.neighbours(i)) {
                 if (!in_vc[v]) {
                     std::cerr << "Edge " << i << "," << v << " is uncovered!" << std::endl;
                     return false;
@@ -127,436 +212,251 @@ bool check_vertex_cover(const SparseGraph & g, const vector<int> & vc) {
     return true;
 }
 
-struct Result
+// What each phase of the solver cost, for --stats.  Components that are
+// solved by max_independent_set_of_tiny_graph() are only counted.
+struct SolverStats
 {
-    VtxList vertex_cover;
-    long search_node_count;
-    Result(const SparseGraph & g) : vertex_cover(g.n), search_node_count(0) {}
+    Duration read_time {};
+    Duration kernelize_time {};
+    Duration search_time {};
+    Duration unwind_time {};
+    KernelizerStats kernelizer;
+    long kernel_size = 0;
+    long num_tiny_components = 0;
+    long num_tiny_component_vertices = 0;
+    vector<ComponentStats> components;
 };
 
-struct Reduction
-{
-    virtual void unwind(vector<bool> & in_cover) = 0;
-    virtual ~Reduction() {}
-};
-
-// a list of tuples (v, w, x), where v is the vertex of deg 2,
-// w is the kept neighbour and x is the removed neighbour
-struct Deg2Reduction : public Reduction
+struct Result
 {
-    int v;
-    int w;
-    int x;
-
-    Deg2Reduction(int v, int w, int x) : v(v), w(w), x(x) {}
-
-    void unwind(vector<bool> & in_cover)
-    {
-        if (in_cover[w]) {
-            in_cover[x] = true;
-        } else {
-            in_cover[v] = true;
-        }
-    }
-
-    ~Deg2Reduction() {}
+    VtxList vertex_cover;
+    long search_node_count;
+    long gap;    // vertex_cover is at most this many vertices larger than the minimum
+    SolverStats stats;
+    Result(const SparseGraph & g) : vertex_cover(g.n), search_node_count(0), gap(0) {}
 };
 
-// a list of tuples (v, w, x, y), where v is the vertex of deg 3,
-// and w and x are the kept neighbours
-struct FunnelReduction : public Reduction
+// The connected components of a graph that have at least one edge.  The
+// vertices of all components are stored in one array: component i is
+// vertices[start[i]] to vertices[start[i+1]-1].
+struct ComponentList
 {
-    int v;
-    vector<int> ww;
-    int y;
-
-    FunnelReduction(int v, vector<int> ww, int y) : v(v), ww(ww), y(y) {}
+    vector<int> vertices;
+    vector<unsigned> start;
 
-    bool all_ww_are_in_cover(vector<bool> & in_cover)
+    auto size() const -> unsigned
     {
-        for (int w : ww)
-            if (!in_cover[w])
-                return false;
-        return true;
+        return start.size() - 1;
     }
 
-    void unwind(vector<bool> & in_cover)
+    auto component_size(unsigned i) const -> unsigned
     {
-        if (all_ww_are_in_cover(in_cover)) {
-            in_cover[y] = true;
-        } else {
-            in_cover[v] = true;
-        }
+        return start[i + 1] - start[i];
     }
-
-    ~FunnelReduction() {}
 };
 
-struct BowTieReduction : public Reduction
+auto make_list_of_components(const SparseGraph & g) -> ComponentList
 {
-    int v;
-    int a;
-    int b;
-    int c;
-    int d;
-
-    BowTieReduction(int v, int a, int b, int c, int d) : v(v), a(a), b(b), c(c), d(d) {}
-
-    void unwind(vector<bool> & in_cover)
-    {
-        if (!in_cover[a]) {
-            in_cover[c] = false;
-            in_cover[v] = true;
-        } else if (!in_cover[b]) {
-            in_cover[d] = false;
-            in_cover[v] = true;
-        } else if (!in_cover[c]) {
-            in_cover[b] = false;
-            in_cover[v] = true;
-        } else if (!in_cover[d]) {
-            in_cover[a] = false;
-            in_cover[v] = true;
-        } else {
-            in_cover[v] = false;
-        }
-    }
-
-    ~BowTieReduction() {}
-};
+    ComponentList components;
+    components.vertices.reserve(g.n);
+    components.start.push_back(0);
+    vector<bool> vertex_used(g.n);
+    for (unsigned i=0; i<g.n; i++)
+        if (g.neighbours(i).empty())
+            vertex_used[i] = true;
 
-bool isolated_vertex_removal(SparseGraph & g,
-        vector<bool> & in_cover, vector<bool> & deleted)
-{
-    bool made_a_change = false;
-    vector<int> neighbours;
-    for (unsigned v=0; v<g.n; v++) {
-        if (!deleted[v]) {
-            neighbours.clear();
-            for (int w : g.adjlist[v])
-                if (!deleted[w])
-                    neighbours.push_back(w);
-            if (g.vv_are_clique(neighbours)) {
-                deleted[v] = true;
-                made_a_change = true;
-                for (int w : neighbours) {
-                    deleted[w] = true;
-                    in_cover[w] = true;
-                    for (int u : g.adjlist[w]) {
-                        auto & lst = g.adjlist[u];
-                        lst.erase(std::find(lst.begin(), lst.end(), w));
+    // Each component is explored breadth-first, using the part of the
+    // vertices array that holds it as the queue
+    auto & vv = components.vertices;
+    for (unsigned i=0; i<g.n; i++) {
+        if (!vertex_used[i]) {
+            vertex_used[i] = true;
+            vv.push_back(i);
+            for (unsigned j=components.start.back(); j<vv.size(); j++) {
+                for (int w : g.neighbours(vv[j])) {
+                    if (!vertex_used[w]) {
+                        vertex_used[w] = true;
+                        vv.push_back(w);
                     }
-                    g.adjlist[w].clear();
                 }
             }
+            components.start.push_back(vv.size());
         }
     }
-    return made_a_change;
-}
 
-// Remove w from the adjacency list of v.
-// It is the caller's responsibility to ensure that v gets removed
-// from the adjacency list of w.
-auto remove_from_adj_list(SparseGraph & g, int v, int w)
-{
-    auto & lst = g.adjlist[v];
-    lst.erase(std::find(lst.begin(), lst.end(), w));
-}
-
-bool vertex_folding(SparseGraph & g, vector<bool> & deleted,
-        vector<std::unique_ptr<Reduction>> & reductions)
-{
-    bool made_a_change = false;
-
-    for (unsigned v=0; v<g.n; v++) {
-        if (g.adjlist[v].size() == 2) {
-            int w = g.adjlist[v][0];
-            int x = g.adjlist[v][1];
-
-            // for this reduction, w and x must not be adjacent
-            if (!g.has_edge(x, w)) {
-                remove_from_adj_list(g, w, v);
-                remove_from_adj_list(g, x, v);
-                for (int u : g.adjlist[x]) {
-                    remove_from_adj_list(g, u, x);
-                    if (!g.has_edge(u, w))
-                        g.add_edge(w, u);
-                }
-                g.adjlist[v].clear();
-                g.adjlist[x].clear();
-                deleted[v] = true;
-                deleted[x] = true;
-                reductions.push_back(std::make_unique<Deg2Reduction>(v, w, x));
-                made_a_change = true;
-            }
-        }
-    }
-    return made_a_change;
+    return components;
 }
 
-bool has_any_edge(SparseGraph & g, int v, vector<int> & ww)
-{
-    for (int w : ww)
-        if (w != v && g.has_edge(v, w))
-                return true;
-    return false;
-}
+// Components with at most this many vertices are solved by
+// max_independent_set_of_tiny_graph() rather than by sequential_mwc()
+#define TINY_COMPONENT_MAX_SIZE 16
 
-int num_edges(SparseGraph & g, vector<int> & vv)
+// Return a maximum independent set of the vertices in the bitset P, where
+// adj[v] is the bitset of v's neighbours.  Vertices of degree 0 or 1 are
+// always taken; otherwise, the search branches on a vertex of maximum degree.
+static auto max_independent_set_of_tiny_graph(const unsigned * adj, unsigned P) -> unsigned
 {
-    int retval = 0;
-    for (int v : vv) {
-        for (int w : vv) {
-            if (w > v && g.has_edge(v, w)) {
-                ++retval;
-            }
+    if (P == 0)
+        return 0;
+
+    int min_degree_v = -1;
+    int max_degree_v = -1;
+    int min_degree = TINY_COMPONENT_MAX_SIZE;
+    int max_degree = -1;
+    for (unsigned Q=P; Q; Q&=Q-1) {
+        int v = __builtin_ctz(Q);
+        int degree = __builtin_popcount(adj[v] & P);
+        if (degree < min_degree) {
+            min_degree = degree;
+            min_degree_v = v;
         }
-    }
-    return retval;
-}
-
-// TODO: maybe do the normal, more general version of funnel
-// in which y can be adjacent so some of ww
-bool do_funnel_reductions(SparseGraph & g, vector<bool> & in_cover, vector<bool> & deleted,
-        vector<std::unique_ptr<Reduction>> & reductions)
-{
-    bool made_a_change = false;
-
-    // Try to find vertex v with neighbours ww and y, such that ws are a clique
-    // and y is not adjacent to any member of ww.
-    // We can then delete v and y, adding the neighbours
-    // of y other than x to the adjacency list of each vertex in ww.
-    for (unsigned v=0; v<g.n; v++) {
-        int lst_sz = g.adjlist[v].size();
-        if (lst_sz >= 3) {
-            if (num_edges(g, g.adjlist[v]) != (lst_sz-1) * (lst_sz-2) / 2)
-                continue;
-
-            for (int y : g.adjlist[v]) {
-                if (!has_any_edge(g, y, g.adjlist[v])) {
-                    vector<int> ww;
-                    for (int w : g.adjlist[v])
-                        if (w != y)
-                            ww.push_back(w);
-
-                    for (int w : ww) {
-                        remove_from_adj_list(g, w, v);
-                    }
-                    remove_from_adj_list(g, y, v);
-                    for (int u : g.adjlist[y]) {
-                        remove_from_adj_list(g, u, y);
-                        for (int w : ww)
-                            if (!g.has_edge(u, w))
-                                g.add_edge(u, w);
-                    }
-                    g.adjlist[v].clear();
-                    g.adjlist[y].clear();
-                    deleted[v] = true;
-                    deleted[y] = true;
-                    reductions.push_back(std::make_unique<FunnelReduction>(v, ww, y));
-                    made_a_change = true;
-
-                    break;
-                }
-            }
+        if (degree > max_degree) {
+            max_degree = degree;
+            max_degree_v = v;
         }
     }
-    return made_a_change;
-}
-
 
-void check_adj_list_integrity(SparseGraph & g)
-{
-    for (unsigned v=0; v<g.n; v++) {
-        std::vector<bool> a(g.n);
-        for (int w : g.adjlist[v]) {
-            if (a[w]) {
-                std::cout << "Duplicate edge" << std::endl;
-                exit(1);
-            }
-            a[w] = true;
-            auto it = std::find(g.adjlist[w].begin(), g.adjlist[w].end(), v);
-            if (it == g.adjlist[w].end()) {
-                std::cout << "Graph error" << std::endl;
-                exit(1);
-            }
-        }
+    if (min_degree <= 1) {
+        int v = min_degree_v;
+        return (1u << v) | max_independent_set_of_tiny_graph(adj, P & ~(1u << v) & ~adj[v]);
     }
-}
 
-
-// If there is a vertex v with a neighbour x who is adjacent to all of v's other neighbours,
-// it's safe to assume that x is in the vertex cover.
-bool do_domination_reductions(SparseGraph & g, vector<bool> & in_cover, vector<bool> & deleted,
-        vector<std::unique_ptr<Reduction>> & reductions)
-{
-    bool made_a_change = false;
-
-    for (unsigned v=0; v<g.n; v++) {
-        if (g.adjlist[v].size() > 2) {
-            for (int w : g.adjlist[v]) {
-                int num_edges = 0;
-                for (int x : g.adjlist[v]) {
-                    if (x != w) {
-                        if (g.has_edge(x, w)) {
-                            ++num_edges;
-                        } else {
-                            // for efficiency.  Maybe this can be tidied?
-                            break;
-                        }
-                    }
-                }
-                if (num_edges == g.adjlist[v].size() - 1) {
-                    for (int u : g.adjlist[w]) {
-                        remove_from_adj_list(g, u, w);
-                    }
-                    g.adjlist[w].clear();
-                    deleted[w] = true;
-                    in_cover[w] = true;
-                    made_a_change = true;
-                    break;
-                }
-            }
-        }
-    }
-    return made_a_change;
+    int v = max_degree_v;
+    unsigned with_v = (1u << v) | max_independent_set_of_tiny_graph(adj, P & ~(1u << v) & ~adj[v]);
+    unsigned without_v = max_independent_set_of_tiny_graph(adj, P & ~(1u << v));
+    return __builtin_popcount(with_v) >= __builtin_popcount(without_v) ? with_v : without_v;
 }
 
-bool are_bow_tie(SparseGraph & g, const vector<int> & adjlist)
+// Find a vertex cover of the component vv of g, and mark its vertices in
+// vertex_in_cover.  Return the number of vertices by which the cover may be
+// larger than the minimum.  Unless the component is tiny, put what its
+// search cost in stats.  old_to_new_vtx must have an element for each vertex
+// of g, all -1; they are -1 again on return.
+auto find_vertex_cover_of_subgraph(const SparseGraph & g, int * vv, unsigned vv_size,
+        vector<int> & old_to_new_vtx, vector<char> & vertex_in_cover, const Params & params,
+        ComponentStats & stats) -> unsigned
 {
-    for (int v : adjlist) {
-        int num_edges = 0;
-        for (int w : adjlist) {
-            if (v != w) {
-                if (g.has_edge(v, w)) {
-                    ++num_edges;
-                    if (num_edges > 1) {
-                        break;
-                    }
-                }
-            }
-        }
-        if (num_edges != 1) {
-            return false;
-        }
+    if (vv_size <= TINY_COMPONENT_MAX_SIZE) {
+        for (unsigned i=0; i<vv_size; i++)
+            old_to_new_vtx[vv[i]] = i;
+        unsigned adj[TINY_COMPONENT_MAX_SIZE] = {};
+        for (unsigned i=0; i<vv_size; i++)
+            for (int w : g.neighbours(vv[i]))
+                adj[i] |= 1u << old_to_new_vtx[w];
+        for (unsigned i=0; i<vv_size; i++)
+            old_to_new_vtx[vv[i]] = -1;
+
+        unsigned independent_set = max_independent_set_of_tiny_graph(adj, (1u << vv_size) - 1);
+        for (unsigned i=0; i<vv_size; i++)
+            if (!(independent_set & (1u << i)))
+                vertex_in_cover[vv[i]] = true;
+        return 0;
     }
-    return true;
-}
 
-bool do_bow_tie_reductions(SparseGraph & g, vector<bool> & in_cover, vector<bool> & deleted,
-        vector<std::unique_ptr<Reduction>> & reductions)
-{
-    bool made_a_change = false;
+    printf("c COMPONENT %d\n", int(vv_size));
+    auto start_time = steady_clock::now();
+    std::sort(vv, vv + vv_size);
+    vector<int> component(vv, vv + vv_size);
+    SparseGraph subgraph(vv_size);
+    g.induced_subgraph<SparseGraph>(component, old_to_new_vtx, subgraph);
 
-    for (unsigned v=0; v<g.n; v++) {
-        if (g.adjlist[v].size() == 4) {
-            auto & lst_v = g.adjlist[v];
-            if (are_bow_tie(g, lst_v)) {
-                int a = lst_v[0];
-                int b = lst_v[1];
-                int c = lst_v[2];
-                int d = lst_v[3];
-                if (g.has_edge(a, c)) {
-                    std::swap(b, c);
-                } else if (g.has_edge(a, d)) {
-                    std::swap(b, d);
-                }
+    VtxList independent_set(subgraph.n);
+    stats.size = vv_size;
+    stats.num_edges = subgraph.num_edges();
 
-                for (int u : g.adjlist[v]) {
-                    remove_from_adj_list(g, u, v);
-                }
-                g.adjlist[v].clear();
-                deleted[v] = true;
-
-                vector<int> adjlist_a = g.adjlist[a];
-                vector<int> adjlist_b = g.adjlist[b];
-                vector<int> adjlist_c = g.adjlist[c];
-                vector<int> adjlist_d = g.adjlist[d];
-                for (int u : adjlist_c)
-                    if (!g.has_edge(a, u))
-                        g.add_edge(a, u);
-                for (int u : adjlist_d)
-                    if (!g.has_edge(b, u))
-                        g.add_edge(b, u);
-                for (int u : adjlist_b)
-                    if (!g.has_edge(c, u))
-                        g.add_edge(c, u);
-                for (int u : adjlist_a)
-                    if (!g.has_edge(d, u))
-                        g.add_edge(d, u);
-
-                reductions.push_back(std::make_unique<BowTieReduction>(v, a, b, c, d));
-                made_a_change = true;
-            }
+    int bound = sequential_mwc(subgraph, params, independent_set, stats);
+
+    vector<bool> vtx_is_in_ind_set(subgraph.n);
+    for (int v : independent_set.vv) {
+        vtx_is_in_ind_set[v] = true;
+    }
+    for (unsigned i=0; i<vv_size; i++) {
+        if (!vtx_is_in_ind_set[i]) {
+            vertex_in_cover[vv[i]] = true;
         }
     }
-
-    return made_a_change;
+    stats.time = steady_clock::now() - start_time;
+    stats.peak_rss_kb = peak_rss_kb();
+    return bound - independent_set.vv.size();
 }
 
-auto make_list_of_components(const SparseGraph & g) -> vector<vector<int>>
+// Components are packed into tasks of at least this many vertices, so that
+// the worker threads don't contend over thousands of tiny components
+#define MIN_VERTICES_PER_TASK 256
+
+// Find a vertex cover of each component, using params.num_threads threads,
+// and mark its vertices in vertex_in_cover.  Return the total of the
+// components' gaps, and add what the components cost to stats.
+// With algorithm 5 the threads share the search of each component instead,
+// and the components are solved one at a time.
+auto find_vertex_covers_of_components(const SparseGraph & g, ComponentList & components,
+        vector<char> & vertex_in_cover, const Params & params, SolverStats & stats) -> long
 {
-    vector<vector<int>> components;
-    vector<bool> vertex_used(g.n);
-    for (unsigned i=0; i<g.n; i++)
-        if (g.adjlist[i].empty())
-            vertex_used[i] = true;
+    // Start with the largest components, so that a big one isn't left until
+    // the end while the other threads sit idle
+    vector<unsigned> order(components.size());
+    for (unsigned i=0; i<components.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {
+        return components.component_size(a) > components.component_size(b);
+    });
+
+    // Each task is a range of positions in order
+    vector<std::pair<unsigned, unsigned>> tasks;
+    for (unsigned i=0; i<order.size(); ) {
+        unsigned j = i;
+        unsigned num_vertices = 0;
+        while (j < order.size() && num_vertices < MIN_VERTICES_PER_TASK)
+            num_vertices += components.component_size(order[j++]);
+        tasks.push_back({i, j});
+        i = j;
+    }
 
-    for (unsigned i=0; i<g.n; i++) {
-        if (!vertex_used[i]) {
-            components.push_back({int(i)});
-            auto & component = components.back();
-            vector<int> to_explore = {int(i)};
-            vertex_used[i] = true;
-            while (!to_explore.empty()) {
-                int v = to_explore.back();
-                to_explore.pop_back();
-                for (int w : g.adjlist[v]) {
-                    if (!vertex_used[w]) {
-                        component.push_back(w);
-                        to_explore.push_back(w);
-                        vertex_used[w] = true;
-                    }
-                }
+    atomic<unsigned> next_task(0);
+    atomic<long> total_gap(0);
+    mutex stats_mutex;
+
+    // Components are disjoint, so the workers write to different elements of
+    // vertex_in_cover
+    auto worker = [&]() {
+        vector<int> old_to_new_vtx(g.n, -1);
+        long gap = 0;
+        vector<ComponentStats> component_stats;
+        unsigned t;
+        while ((t = next_task++) < tasks.size()) {
+            for (unsigned i=tasks[t].first; i<tasks[t].second; i++) {
+                unsigned c = order[i];
+                ComponentStats cs;
+                gap += find_vertex_cover_of_subgraph(g, &components.vertices[components.start[c]],
+                        components.component_size(c), old_to_new_vtx, vertex_in_cover, params, cs);
+                if (cs.size)
+                    component_stats.push_back(cs);
             }
         }
-    }
+        total_gap += gap;
 
-    return components;
-}
-
-auto find_vertex_cover_of_subgraph(const SparseGraph & g, vector<int> component,
-        const Params & params) -> vector<int>
-{
-    std::sort(component.begin(), component.end());
-    SparseGraph subgraph = g.induced_subgraph<SparseGraph>(component);
-
-//    for (unsigned v=0; v<subgraph.n; v++) {
-//        for (int w : subgraph.adjlist[v]) {
-//            for (int u : subgraph.adjlist[v]) {
-//                std::cout << (subgraph.has_edge(w, u) ? "X " : ". ");
-//            }
-//            std::cout << std::endl;
-//        }
-//        std::cout << std::endl;
-//    }
-//    subgraph.print_dimacs_format();
-
-    VtxList independent_set(g.n);
-    long search_node_count = 0;
-
-    sequential_mwc(subgraph, params, independent_set, search_node_count);
+        std::lock_guard<mutex> lock(stats_mutex);
+        stats.components.insert(stats.components.end(), component_stats.begin(), component_stats.end());
+    };
 
-    vector<bool> vtx_is_in_ind_set(subgraph.n);
-    for (int v : independent_set.vv) {
-        vtx_is_in_ind_set[v] = true;
-    }
-    vector<int> vertex_cover;
-    for (unsigned i=0; i<component.size(); i++) {
-        if (!vtx_is_in_ind_set[i]) {
-            vertex_cover.push_back(component[i]);
+    int num_component_threads = params.algorithm_num == 5 ? 1 : params.num_threads;
+    vector<std::thread> threads;
+    for (int i=1; i<std::min(num_component_threads, int(tasks.size())); i++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto & thread : threads)
+        thread.join();
+
+    std::stable_sort(stats.components.begin(), stats.components.end(),
+            [](const ComponentStats & a, const ComponentStats & b) { return a.size > b.size; });
+    stats.kernel_size = components.vertices.size();
+    for (unsigned i=0; i<components.size(); i++) {
+        if (components.component_size(i) <= TINY_COMPONENT_MAX_SIZE) {
+            ++stats.num_tiny_components;
+            stats.num_tiny_component_vertices += components.component_size(i);
         }
     }
-    return vertex_cover;
+    return total_gap;
 }
 
 auto mwc(SparseGraph g, const Params & params) -> Result
@@ -567,18 +467,18 @@ auto mwc(SparseGraph g, const Params & params) -> Result
 
     vector<std::unique_ptr<Reduction>> reductions;
 
-    while (true) {
-        bool a = isolated_vertex_removal(g, in_cover, deleted);
-        bool b = do_domination_reductions(g, in_cover, deleted, reductions);
-        bool c = vertex_folding(g, deleted, reductions);
-        bool d = do_funnel_reductions(g, in_cover, deleted, reductions);
-        bool e = false;  //do_bow_tie_reductions(g, in_cover, deleted, reductions);
-        if (!a && !b && !c && !d && !e)
-            break;
-    };
-    check_adj_list_integrity(g);
-
-    vector<vector<int>> components = make_list_of_components(g);
+    Result result(g);
+    auto start_time = steady_clock::now();
+    Kernelizer kernelizer(g, in_cover, deleted, reductions, arguments.kernelizer_options);
+    kernelizer.run();
+    result.stats.kernelizer = kernelizer.stats;
+    if (arguments.kernelizer_options.lp)
+        printf("c LP lower bound for the kernel %ld\n", kernelizer.lp_lower_bound);
+    if (arguments.check_integrity && !check_adj_list_integrity(g))
+        exit(1);
+
+    ComponentList components = make_list_of_components(g);
+    result.stats.kernelize_time = steady_clock::now() - start_time;
 
 //    for (auto & component : components) {
 //        std::cout << "A_COMPONENT";
@@ -589,11 +489,14 @@ auto mwc(SparseGraph g, const Params & params) -> Result
 //    }
 //    std::cout << "END_COMPONENTS" << std::endl;
 
-    Result result(g);
-    for (auto & component : components) {
-        std::cout << "c COMPONENT " << component.size() << std::endl;
-        auto vertex_cover_of_subgraph = find_vertex_cover_of_subgraph(g, component, params);
-        for (int v : vertex_cover_of_subgraph) {
+    start_time = steady_clock::now();
+    vector<char> vertex_in_cover(g.n);
+    result.gap = find_vertex_covers_of_components(g, components, vertex_in_cover, params, result.stats);
+    result.stats.search_time = steady_clock::now() - start_time;
+
+    start_time = steady_clock::now();
+    for (unsigned v=0; v<g.n; v++) {
+        if (vertex_in_cover[v]) {
             in_cover[v] = true;
         }
     }
@@ -608,31 +511,144 @@ auto mwc(SparseGraph g, const Params & params) -> Result
             result.vertex_cover.push_vtx(v, 1);
         }
     }
+    result.stats.unwind_time = steady_clock::now() - start_time;
 
     return result;
 }
 
+static auto to_seconds(Duration d) -> double
+{
+    return std::chrono::duration<double>(d).count();
+}
+
+// Write the statistics as a JSON object on standard error, so that standard
+// output is still a valid PACE solution
+static void print_stats_json(const SparseGraph & g, const Result & result)
+{
+    const SolverStats & stats = result.stats;
+    FILE * out = stderr;
+    fprintf(out, "{\n  \"vertices\": %u,\n  \"edges\": %llu,\n", g.n, g.num_edges());
+    fprintf(out, "  \"phases\": {\"read_seconds\": %.6f, \"kernelize_seconds\": %.6f, "
+            "\"search_seconds\": %.6f, \"unwind_seconds\": %.6f},\n",
+            to_seconds(stats.read_time), to_seconds(stats.kernelize_time), to_seconds(stats.search_time),
+            to_seconds(stats.unwind_time));
+
+    fprintf(out, "  \"reductions\": [");
+    for (int rule=0; rule<NUM_KERNELIZER_RULES; rule++)
+        fprintf(out, "%s\n    {\"rule\": \"%s\", \"removed\": %ld, \"seconds\": %.6f}", rule ? "," : "",
+                kernelizer_rule_names[rule], stats.kernelizer.removed[rule], to_seconds(stats.kernelizer.time[rule]));
+    fprintf(out, "\n  ],\n");
+
+    fprintf(out, "  \"kernel\": {\"vertices\": %ld, \"tiny_components\": %ld, \"tiny_component_vertices\": %ld},\n",
+            stats.kernel_size, stats.num_tiny_components, stats.num_tiny_component_vertices);
+
+    fprintf(out, "  \"components\": [");
+    const char * sep = "";
+    for (auto & c : stats.components) {
+        double density = c.size > 1 ? 2.0 * c.num_edges / (double(c.size) * (c.size - 1)) : 0;
+        double seconds = to_seconds(c.time);
+        fprintf(out, "%s\n    {\"size\": %u, \"edges\": %ld, \"density\": %.6f, \"search_nodes\": %ld, "
+                "\"nodes_per_second\": %.1f, \"seconds\": %.6f, \"colouring_seconds\": %.6f, "
+                "\"unit_propagation_seconds\": %.6f, \"local_search_seconds\": %.6f, "
+                "\"colouring_number_seconds\": %.6f, \"closed_by\": \"%s\", \"peak_rss_kb\": %ld}",
+                sep, c.size, c.num_edges, density, c.search_node_count,
+                seconds > 0 ? c.search_node_count / seconds : 0.0, seconds, to_seconds(c.colouring_time),
+                to_seconds(c.unit_propagation_time), to_seconds(c.local_search_time),
+                to_seconds(c.colouring_number_time), c.closed_by, c.peak_rss_kb);
+        sep = ",";
+    }
+    fprintf(out, "%s],\n", stats.components.empty() ? "" : "\n  ");
+
+    long size = result.vertex_cover.vv.size();
+    fprintf(out, "  \"cover_size\": %ld,\n  \"lower_bound\": %ld,\n  \"aborted\": %s,\n  \"peak_rss_kb\": %ld\n}\n",
+            size, size - result.gap, aborted ? "true" : "false", peak_rss_kb());
+}
+
+// Append the decimal digits of a non-negative number to out
+static void append_number(std::string & out, unsigned long x)
+{
+    char digits[20];
+    int len = 0;
+    do {
+        digits[len++] = '0' + x % 10;
+        x /= 10;
+    } while (x);
+    while (len)
+        out += digits[--len];
+}
+
+// Print the solution in PACE format, with a single write
+static void print_vertex_cover(unsigned n, const vector<int> & vv)
+{
+    std::string out = "s vc ";
+    out.reserve(32 + vv.size() * 8);
+    append_number(out, n);
+    out += ' ';
+    append_number(out, vv.size());
+    out += '\n';
+    for (int v : vv) {
+        append_number(out, v + 1);
+        out += '\n';
+    }
+    fwrite(out.data(), 1, out.size(), stdout);
+    fflush(stdout);
+}
+
+// Called on SIGTERM, and on SIGALRM when the time limit passes
+static void abort_search(int)
+{
+    aborted = true;
+}
+
 int main(int argc, char** argv) {
     argp_parse(&argp, argc, argv, 0, 0, 0);
 
-    if (arguments.algorithm_num != 5)
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = abort_search;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGALRM, &action, nullptr);
+    if (arguments.time_limit > 0)
+        alarm(arguments.time_limit);
+
+    if (arguments.num_threads < 1)
         arguments.num_threads = 1;
 
+    auto start_time = steady_clock::now();
     SparseGraph g =
-            arguments.file_format==FileFormat::Pace ? readSparseGraphPaceFormat() :
-                                                      readSparseGraph();
+            arguments.file_format==FileFormat::Pace ? readSparseGraphPaceFormat(arguments.num_threads) :
+            arguments.file_format==FileFormat::Dimacs ? readSparseGraph(arguments.num_threads) :
+                                                        readSparseGraphCsrSnapshot();
+
+    if (arguments.csr_snapshot_filename) {
+        write_csr_snapshot(g, arguments.csr_snapshot_filename);
+        return 0;
+    }
 
     Params params {arguments.colouring_variant, arguments.max_sat_level, arguments.algorithm_num,
-            arguments.num_threads, arguments.quiet, arguments.unweighted_sort};
+            arguments.num_threads, arguments.quiet, arguments.unweighted_sort,
+            arguments.bitset_unit_propagation, arguments.local_search_threads, arguments.reduce_interval,
+            arguments.absolute_gap, arguments.relative_gap, arguments.stats};
 
+    Duration read_time = steady_clock::now() - start_time;
     Result result = mwc(g, params);
+    result.stats.read_time = read_time;
 
     // sort vertices in clique by index
     std::sort(result.vertex_cover.vv.begin(), result.vertex_cover.vv.end());
 
-    std::cout << "s vc " << g.n << " " << result.vertex_cover.vv.size() << std::endl;
-    for (int v : result.vertex_cover.vv)
-        std::cout << (v+1) << std::endl;
+    if (aborted)
+        printf("c search aborted: the vertex cover is valid but may not be minimum\n");
+    // the reductions add the same number of vertices to every cover of the
+    // kernel that they unwind, so the kernel's gap carries over
+    long size = result.vertex_cover.vv.size();
+    long lower_bound = size - result.gap;
+    printf("c lower bound %ld, gap %ld (%.2f%%)\n", lower_bound, result.gap,
+            lower_bound ? 100.0 * result.gap / lower_bound : 0.0);
+    print_vertex_cover(g.n, result.vertex_cover.vv);
+    if (arguments.stats)
+        print_stats_json(g, result);
 
 //    printf("Stats: status program algorithm_number max_sat_level num_threads size weight nodes\n");
 //    std::cout <<
@@ -1,276 +1,333 @@
 #include "sparse_graph.h"
+#include "input_buffer.h"
+#include "csr_snapshot.h"
 #include "util.h"
 
+#include <stdio.h>
+
 #include <algorithm>
 #include <cctype>
-//#include <fstream>
-#include <ios>
-#include <iostream>
-#include <sstream>
-
-auto deduplicate_and_add_edges(SparseGraph & g, vector<Edge> & edges)
-{
-    std::sort(edges.begin(), edges.end());
-    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
-    printf("c %d edges after de-duplication\n", int(edges.size()));
-
-    for (Edge e : edges) {
-        int v = e.first;
-        int w = e.second;
-        if (v == w) {
-            g.add_loop(v);
-        } else {
-            g.add_edge(v, w);
-        }
-    }
+#include <string>
+#include <thread>
 
-    g.sort_adj_lists();
-}
+// Inputs smaller than this are parsed by a single thread
+#define PARSE_MIN_BYTES_PER_THREAD (1 << 20)
 
-SparseGraph readSparseGraph() {
-    int medges = 0;
-    int edges_read = 0;
+#define RADIX_BITS 11
+#define RADIX_BUCKETS (1 << RADIX_BITS)
 
-    struct SparseGraph g(0);
+// Arrays smaller than this are sorted by a single thread
+#define RADIX_SORT_MIN_KEYS_PER_THREAD (1 << 16)
 
-    vector<Edge> edges;
+// A hand-written scanner over the bytes from p to end.  Lines end with '\n',
+// and '\r' is treated as a blank.
+struct Scanner
+{
+    const char * p;
+    const char * end;
 
+    auto at_end_of_line() const -> bool
     {
-        std::string line;
-        while (std::getline(std::cin, line)) {
-            std::stringstream line_stream(line);
-            std::string token;
-            if (!(line_stream >> token))
-                continue;
-            if (token == "e") {
-                int v, w;
-                if (!(line_stream >> v) || !(line_stream >> w))
-                    fail("Error reading a line beginning with e.\n");
-                if (v < w)
-                    edges.push_back({v-1, w-1});
-                else if (v > w)
-                    edges.push_back({w-1, v-1});
-                edges_read++;
-            } else if (token == "p") {
-                long n, m;
-                if (!(line_stream >> token) || token != "edge" || !(line_stream >> n) || !(line_stream >> m))
-                    fail("Error reading a line beginning with p.\n");
-                printf("c %ld vertices\n", n);
-                printf("c %ld edges\n", m);
-                if (n > INT_MAX)
-                    fail("Too many vertices.\n");
-                if (m > INT_MAX)
-                    fail("Too many edges.\n");
-                medges = m;
-                g = SparseGraph(n);
-            } else if (token == "n") {
-                int v;
-                long wt;
-                if (!(line_stream >> v) || !(line_stream >> wt))
-                    fail("Error reading a line beginning with n.\n");
-                g.weight[v-1] = wt;
-            }
-        }
+        return p == end || *p == '\n';
     }
 
-    if (medges>0 && int(edges.size()) != medges)
-        fail("Unexpected number of edges.");
-
-    deduplicate_and_add_edges(g, edges);
-
-    return g;
-}
-
-SparseGraph readSparseGraphPaceFormat() {
-    int medges = 0;
-    int edges_read = 0;
-
-    struct SparseGraph g(0);
-
-    vector<Edge> edges;
-
+    auto skip_blanks() -> void
     {
-        std::string line;
-        while (std::getline(std::cin, line)) {
-            std::stringstream line_stream(line);
-            std::string token;
-            if (!(line_stream >> token))
-                continue;
-            if (token[0] >= '0' && token[0] <= '9') {
-                int v=-1, w;
-                try {
-                    v = std::stoi(token);
-                } catch (std::invalid_argument) {
-                    fail("Invalid edge");
-                }
-                if (!(line_stream >> w))
-                    fail("Error reading a line beginning with e.\n");
-                if (v < w)
-                    edges.push_back({v-1, w-1});
-                else
-                    edges.push_back({w-1, v-1});
-                edges_read++;
-                if (edges_read == medges)
-                    break;
-            } else if (token == "p") {
-                long n, m;
-                if (!(line_stream >> token) || token != "td" || !(line_stream >> n) || !(line_stream >> m))
-                    fail("Error reading a line beginning with p.\n");
-                printf("c %ld vertices\n", n);
-                printf("c %ld edges\n", m);
-                if (n > INT_MAX)
-                    fail("Too many vertices.\n");
-                if (m > INT_MAX)
-                    fail("Too many edges.\n");
-                medges = m;
-                g = SparseGraph(n);
-            }
-        }
+        while (p != end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            ++p;
     }
 
-    if (medges>0 && int(edges.size()) != medges)
-        fail("Unexpected number of edges.");
-
-    deduplicate_and_add_edges(g, edges);
-
-    return g;
-}
-
-struct FastFileReader
-{
-private:
-    std::istream & file;
-    char c;
-
-    void advance()
+    auto skip_line() -> void
     {
-        if (!(file >> c))
-            c = 0;
+        while (p != end && *p++ != '\n')
+            ;
     }
 
-public:
-    FastFileReader(std::istream & file) : file(file)
+    auto skip_word() -> void
     {
-        file.unsetf(std::ios_base::skipws);
-        advance();
+        while (p != end && !isspace(*p))
+            ++p;
     }
 
-    int get_digit()
+    auto next_is_digit() const -> bool
     {
-        char ch = c;
-        advance();
-        return ch - '0';
+        return p != end && *p >= '0' && *p <= '9';
     }
 
-    long get_long()
+    // Read a non-negative integer, giving up once it exceeds limit.  Return
+    // false if there is no integer here or it is too large.
+    auto scan_unsigned(long limit, long & result) -> bool
     {
-        long retval = 0;
-        while (is_digit()) {
-            retval *= 10;
-            retval += get_digit();
+        skip_blanks();
+        if (!next_is_digit())
+            return false;
+        long val = 0;
+        while (next_is_digit()) {
+            val = val * 10 + (*p++ - '0');
+            if (val > limit)
+                return false;
         }
-        return retval;
+        result = val;
+        return true;
     }
 
-    bool is_digit()
+    auto scan_long(long & result) -> bool
     {
-        return c >= '0' && c <= '9';
+        skip_blanks();
+        bool negative = p != end && *p == '-';
+        if (negative)
+            ++p;
+        long val;
+        if (!scan_unsigned(LONG_MAX, val))
+            return false;
+        result = negative ? -val : val;
+        return true;
     }
 
-    bool finished()
+    // Skip any empty lines and comment lines
+    auto skip_comments() -> void
     {
-        return c == 0;
+        for (;;) {
+            skip_blanks();
+            if (p != end && (*p == '\n' || *p == 'c'))
+                skip_line();
+            else
+                return;
+        }
     }
+};
 
-    char peek_char()
-    {
-        return c;
+// The edges and vertex weights in one chunk of the input.  Edge {v, w} with
+// v <= w is stored as (v << vtx_bits) | w, using 0-based vertex numbers.
+struct ParsedChunk
+{
+    vector<unsigned long long> edges;
+    vector<std::pair<int, long>> weights;
+};
+
+// The number of bits needed to store a vertex number less than n
+static auto bits_for_vertex_numbers(long n) -> int
+{
+    int bits = 1;
+    while (bits < 63 && (1l << bits) < n)
+        ++bits;
+    return bits;
+}
+
+static auto scan_vertex(Scanner & s, long n, int & v) -> bool
+{
+    long val;
+    if (!s.scan_unsigned(n, val) || val == 0)
+        return false;
+    v = val - 1;
+    return true;
+}
+
+// Parse the lines from begin to end, which must be a whole number of lines
+// after the line beginning with p.  In PACE format, edge lines are pairs of
+// vertex numbers and loops are kept.  In DIMACS format, edge lines begin
+// with e, loops are dropped, and lines beginning with n give vertex weights.
+static auto parse_chunk(const char * begin, const char * end, bool pace_format, long n, int vtx_bits,
+        ParsedChunk & chunk) -> void
+{
+    Scanner s {begin, end};
+    while (s.p != end) {
+        s.skip_blanks();
+        if (s.at_end_of_line()) {
+            s.skip_line();
+            continue;
+        }
+        char ch = *s.p;
+        if (ch == 'p') {
+            fail("Unexpected second line beginning with p.");
+        } else if (pace_format ? s.next_is_digit() : ch == 'e') {
+            if (!pace_format)
+                ++s.p;
+            int v = 0, w = 0;
+            if (!scan_vertex(s, n, v) || !scan_vertex(s, n, w))
+                fail("Error reading an edge line.\n");
+            if (v > w)
+                std::swap(v, w);
+            if (pace_format || v != w)
+                chunk.edges.push_back((static_cast<unsigned long long>(v) << vtx_bits) | w);
+        } else if (!pace_format && ch == 'n') {
+            ++s.p;
+            int v = 0;
+            long wt = 0;
+            if (!scan_vertex(s, n, v) || !s.scan_long(wt))
+                fail("Error reading a line beginning with n.\n");
+            chunk.weights.push_back({v, wt});
+        }
+        s.skip_line();
     }
+}
 
-    char get_char()
-    {
-        char ch = c;
-        advance();
-        return ch;
+// Run f(0), ..., f(num_threads-1) on num_threads threads, including this one
+template<typename F>
+static auto run_in_parallel(int num_threads, F f) -> void
+{
+    vector<std::thread> threads;
+    for (int t=1; t<num_threads; t++)
+        threads.emplace_back(f, t);
+    f(0);
+    for (auto & thread : threads)
+        thread.join();
+}
+
+// Sort keys whose set bits are all below bit num_bits, using a stable LSD radix
+// sort.  In each pass, each thread counts the digits in its part of the array,
+// then moves its part's keys to their places in the output.
+static auto parallel_radix_sort(vector<unsigned long long> & keys, int num_bits, int num_threads) -> void
+{
+    size_t num_keys = keys.size();
+    num_threads = std::max(1, std::min(num_threads, int(num_keys / RADIX_SORT_MIN_KEYS_PER_THREAD)));
+    vector<unsigned long long> sorted(num_keys);
+    vector<vector<size_t>> positions(num_threads, vector<size_t>(RADIX_BUCKETS));
+    auto part_begin = [&](int t) { return num_keys * t / num_threads; };
+
+    for (int shift=0; shift<num_bits; shift+=RADIX_BITS) {
+        run_in_parallel(num_threads, [&](int t) {
+            auto & count = positions[t];
+            std::fill(count.begin(), count.end(), 0);
+            for (size_t i=part_begin(t); i<part_begin(t + 1); i++)
+                ++count[(keys[i] >> shift) & (RADIX_BUCKETS - 1)];
+        });
+
+        // each thread's keys with a given digit go after those of the
+        // previous threads
+        size_t total = 0;
+        for (int digit=0; digit<RADIX_BUCKETS; digit++) {
+            for (int t=0; t<num_threads; t++) {
+                size_t count = positions[t][digit];
+                positions[t][digit] = total;
+                total += count;
+            }
+        }
+
+        run_in_parallel(num_threads, [&](int t) {
+            auto & position = positions[t];
+            for (size_t i=part_begin(t); i<part_begin(t + 1); i++)
+                sorted[position[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++] = keys[i];
+        });
+        keys.swap(sorted);
     }
+}
 
-    void skip_ws()
-    {
-        while (std::isspace(c))
-            advance();
+// Build g from the sorted, de-duplicated edges.  Since the edges {v, w} with
+// v <= w are in lexicographic order, each vertex receives its neighbours in
+// increasing order, and so the adjacency lists are sorted.
+static auto add_sorted_edges(SparseGraph & g, const vector<unsigned long long> & edges, int vtx_bits) -> void
+{
+    unsigned long long mask = (1ull << vtx_bits) - 1;
+    vector<int> degree(g.n);
+    for (unsigned long long e : edges) {
+        int v = e >> vtx_bits;
+        int w = e & mask;
+        if (v != w) {
+            ++degree[v];
+            ++degree[w];
+        }
     }
+    g.reserve_adj_lists(degree);
 
-    void skip_ws_alpha()
-    {
-        while (std::isspace(c) || std::isalpha(c))
-            advance();
+    for (unsigned long long e : edges) {
+        int v = e >> vtx_bits;
+        int w = e & mask;
+        if (v == w) {
+            g.add_loop(v);
+        } else {
+            g.add_edge(v, w);
+        }
     }
+}
 
-    void skip_to_end_of_line()
-    {
-        while (c != 10 && c != 13)
-            advance();
-        skip_ws();
+static SparseGraph read_graph(bool pace_format, int num_threads)
+{
+    InputBuffer input;
+    Scanner s {input.begin(), input.end()};
+
+    s.skip_comments();
+    long n = 0, m = 0;
+    if (s.p == s.end || *s.p != 'p')
+        fail("Expected a line beginning with p.\n");
+    ++s.p;
+    s.skip_blanks();
+    const char * format_begin = s.p;
+    s.skip_word();
+    std::string format(format_begin, s.p);
+    if (format != (pace_format ? "td" : "edge") || !s.scan_unsigned(LONG_MAX, n) || !s.scan_unsigned(LONG_MAX, m))
+        fail("Error reading a line beginning with p.\n");
+    s.skip_line();
+    printf("c %ld vertices\n", n);
+    printf("c %ld edges\n", m);
+    if (n > INT_MAX)
+        fail("Too many vertices.\n");
+
+    // split the rest of the input into chunks of whole lines
+    num_threads = std::max(1, std::min(num_threads, int((s.end - s.p) / PARSE_MIN_BYTES_PER_THREAD)));
+    vector<const char *> chunk_begin(num_threads + 1);
+    chunk_begin[0] = s.p;
+    chunk_begin[num_threads] = s.end;
+    for (int t=1; t<num_threads; t++) {
+        Scanner chunk_start {chunk_begin[t - 1] + (s.end - chunk_begin[t - 1]) / (num_threads - t + 1), s.end};
+        chunk_start.skip_line();
+        chunk_begin[t] = chunk_start.p;
     }
-};
 
-SparseGraph fastReadSparseGraphPaceFormat() {
-    int medges = 0;
-    int edges_read = 0;
+    int vtx_bits = bits_for_vertex_numbers(n);
+    vector<ParsedChunk> chunks(num_threads);
+    run_in_parallel(num_threads, [&](int t) {
+        parse_chunk(chunk_begin[t], chunk_begin[t + 1], pace_format, n, vtx_bits, chunks[t]);
+    });
+
+    vector<unsigned long long> edges;
+    size_t num_edges = 0;
+    for (auto & chunk : chunks)
+        num_edges += chunk.edges.size();
+    edges.reserve(num_edges);
+    for (auto & chunk : chunks) {
+        edges.insert(edges.end(), chunk.edges.begin(), chunk.edges.end());
+        vector<unsigned long long>().swap(chunk.edges);
+    }
 
-    struct SparseGraph g(0);
+    // In PACE format, anything after the m-th edge is ignored
+    if (pace_format && m > 0 && long(edges.size()) > m)
+        edges.resize(m);
+    if (m > 0 && long(edges.size()) != m)
+        fail("Unexpected number of edges.");
 
-    vector<Edge> edges;
+    parallel_radix_sort(edges, 2 * vtx_bits, num_threads);
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    printf("c %lu edges after de-duplication\n", (unsigned long) edges.size());
 
-    {
-        FastFileReader ffr(std::cin);
-
-        std::string line;
-
-        while (!ffr.finished()) {
-            char ch = ffr.peek_char();
-            if (ch == 'c') {
-                ffr.skip_to_end_of_line();
-            } else if (ffr.is_digit()) {
-                int v = ffr.get_long();
-                ffr.skip_ws();
-                if (!ffr.is_digit())
-                    fail("Error reading an edge line.\n");
-                int w = ffr.get_long();
-                ffr.skip_ws();
-                if (v < w)
-                    edges.push_back({v-1, w-1});
-                else
-                    edges.push_back({w-1, v-1});
-                edges_read++;
-            } else if (ch == 'p') {
-                ffr.skip_ws_alpha();
-                if (!ffr.is_digit())
-                    fail("Error reading a line beginning with p.\n");
-                long n = ffr.get_long();
-                ffr.skip_ws();
-                if (!ffr.is_digit())
-                    fail("Error reading a line beginning with p.\n");
-                long m = ffr.get_long();
-                ffr.skip_ws();
-                printf("c %ld vertices\n", n);
-                printf("c %ld edges\n", m);
-                if (n > INT_MAX)
-                    fail("Too many vertices.\n");
-                if (m > INT_MAX)
-                    fail("Too many edges.\n");
-                medges = m;
-                g = SparseGraph(n);
-            } else {
-                fail("Unexpected character in input.");
-            }
-        }
-    }
+    SparseGraph g(n);
+    for (auto & chunk : chunks)
+        for (auto & vtx_and_wt : chunk.weights)
+            g.weight[vtx_and_wt.first] = vtx_and_wt.second;
+    add_sorted_edges(g, edges, vtx_bits);
 
-    if (medges>0 && int(edges.size()) != medges)
-        fail("Unexpected number of edges.");
+    return g;
+}
 
-    deduplicate_and_add_edges(g, edges);
+SparseGraph readSparseGraph(int num_threads)
+{
+    return read_graph(false, num_threads);
+}
 
+SparseGraph readSparseGraphPaceFormat(int num_threads)
+{
+    return read_graph(true, num_threads);
+}
+
+SparseGraph readSparseGraphCsrSnapshot()
+{
+    CsrSnapshot snapshot;
+    printf("c %u vertices\n", snapshot.n);
+    printf("c %lu edges\n", (unsigned long) (snapshot.num_adj_entries / 2));
+
+    SparseGraph g(snapshot.n);
+    g.assign_adj_lists(snapshot.offsets, snapshot.neighbours);
+    g.weight.assign(snapshot.weights, snapshot.weights + g.n);
+    g.vertex_has_loop.assign(snapshot.has_loop, snapshot.has_loop + g.n);
     return g;
 }
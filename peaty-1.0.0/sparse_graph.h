@@ -3,13 +3,16 @@
 
 #include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <thread>
 #include <vector>
 
+#include "edge_hash_set.h"
 #include "graph.h"
 #include "util.h"
 
@@ -28,20 +31,296 @@ struct ColourClass
     long weight;
 };
 
+// Vertices with a higher degree than this are hubs, whose edges to one another
+// are kept in the edge index if it is enabled
+#define EDGE_INDEX_MIN_DEGREE 16
+
+// Marks a removed entry in an adjacency list
+#define ADJ_LIST_TOMBSTONE -1
+
+// When the adjacency lists are laid out in bulk, each list gets this many
+// spare slots, plus one for every ADJ_LIST_SLACK_DIVISOR neighbours
+#define ADJ_LIST_MIN_SLACK 2
+#define ADJ_LIST_SLACK_DIVISOR 8
+
+// The smallest capacity given to a list that has to be moved to grow
+#define ADJ_LIST_MIN_CAPACITY 4
+
+// A read-only view of a vertex's adjacency list, which skips tombstones.  The
+// view is invalidated by any change to the graph.
+class AdjList
+{
+    const int * first;
+    const int * last;
+    int degree;
+
+public:
+    class iterator
+    {
+        const int * p;
+        const int * last;
+
+        auto skip_tombstones() -> void
+        {
+            while (p != last && *p == ADJ_LIST_TOMBSTONE)
+                ++p;
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int *;
+        using reference = const int &;
+
+        iterator(const int * p, const int * last) : p(p), last(last)
+        {
+            skip_tombstones();
+        }
+
+        auto operator*() const -> const int & { return *p; }
+
+        auto operator++() -> iterator &
+        {
+            ++p;
+            skip_tombstones();
+            return *this;
+        }
+
+        auto operator++(int) -> iterator
+        {
+            iterator retval = *this;
+            ++*this;
+            return retval;
+        }
+
+        auto operator==(const iterator & other) const -> bool { return p == other.p; }
+        auto operator!=(const iterator & other) const -> bool { return p != other.p; }
+    };
+
+    AdjList(const int * first, const int * last, int degree) : first(first), last(last), degree(degree) {}
+
+    auto begin() const -> iterator { return iterator(first, last); }
+    auto end() const -> iterator { return iterator(last, last); }
+    auto size() const -> size_t { return degree; }
+    auto empty() const -> bool { return degree == 0; }
+
+    // The i-th neighbour, in O(i + number of tombstones) time
+    auto operator[](int i) const -> int
+    {
+        auto it = begin();
+        while (i--)
+            ++it;
+        return *it;
+    }
+
+    auto to_vector() const -> vector<int>
+    {
+        return vector<int>(begin(), end());
+    }
+};
+
+// A graph stored in compressed sparse row form.  All adjacency lists share one
+// array, adj_slots, and each vertex's list occupies a range of it given by
+// adj_extent, with 64-bit offsets so that the number of edges is not limited
+// to INT_MAX.
+//
+// A removed neighbour is overwritten with a tombstone rather than shifting the
+// rest of the list, and a list is compacted in place once its tombstones
+// outnumber its live entries.  An added neighbour goes into the slack at the
+// end of the list if there is any; otherwise the list is moved to the end of
+// adj_slots with double the capacity.  The whole array is compacted once the
+// space abandoned by moved lists exceeds half of it.  The order of each list
+// is the same as if it were a vector that was appended to and erased from.
 struct SparseGraph
 {
+    struct AdjListExtent
+    {
+        unsigned long long begin;    // index of the first slot in adj_slots
+        int len;                     // slots in use, including tombstones
+        int capacity;
+        int degree;                  // slots in use, excluding tombstones
+    };
+
     unsigned n;  // number of vertices
 
-    // an adjacency list for each vertex
-    vector<vector<int>> adjlist;
+    vector<AdjListExtent> adj_extent;
+    vector<int> adj_slots;
+    unsigned long long num_abandoned_slots;
 
     // vertex weights
     vector<long> weight;
 
     vector<bool> vertex_has_loop;
 
-    SparseGraph(int n) : n(n), adjlist(n), weight(n, 1), vertex_has_loop(n)
+    // An optional index of the edges between hubs, for constant-time has_edge()
+    // queries where scanning an adjacency list would be slow.  A vertex is
+    // indexed from the moment its degree exceeds EDGE_INDEX_MIN_DEGREE, and an
+    // edge is in the index iff both of its endpoints are indexed.  Once the
+    // index is enabled, it is kept up to date by add_edge(), remove_edge() and
+    // isolate_vertex().
+    bool has_edge_index;
+    vector<bool> vertex_is_indexed;
+    EdgeHashSet edge_index;
+
+    SparseGraph(int n) : n(n), adj_extent(n), num_abandoned_slots(0), weight(n, 1), vertex_has_loop(n),
+            has_edge_index(false)
+    {
+    }
+
+    auto neighbours(int v) const -> AdjList
+    {
+        auto & e = adj_extent[v];
+        const int * first = adj_slots.data() + e.begin;
+        return AdjList(first, first + e.len, e.degree);
+    }
+
+    auto degree(int v) const -> int
+    {
+        return adj_extent[v].degree;
+    }
+
+    auto num_edges() const -> unsigned long long
+    {
+        unsigned long long endpoint_count = 0;
+        for (auto & e : adj_extent)
+            endpoint_count += e.degree;
+        return endpoint_count / 2;
+    }
+
+private:
+    static auto slack(int degree) -> int
+    {
+        return ADJ_LIST_MIN_SLACK + degree / ADJ_LIST_SLACK_DIVISOR;
+    }
+
+    // Copy the live entries of v's list to dst, which may be the list's own
+    // first slot, and return the number copied
+    auto copy_live_entries(int v, int * dst) const -> int
+    {
+        auto & e = adj_extent[v];
+        const int * src = adj_slots.data() + e.begin;
+        int num_copied = 0;
+        for (int i=0; i<e.len; i++)
+            if (src[i] != ADJ_LIST_TOMBSTONE)
+                dst[num_copied++] = src[i];
+        return num_copied;
+    }
+
+    auto compact_adj_list_in_place(int v) -> void
+    {
+        auto & e = adj_extent[v];
+        e.len = copy_live_entries(v, adj_slots.data() + e.begin);
+    }
+
+    // Move all adjacency lists, without tombstones, to a new array in vertex
+    // order.  If final_degree is given, each list gets room for final_degree[v]
+    // entries; otherwise, for its current degree.  Either way it also gets
+    // some slack.
+    auto lay_out_adj_lists(const vector<int> * final_degree) -> void
+    {
+        unsigned long long total_capacity = 0;
+        for (unsigned v=0; v<n; v++) {
+            int d = final_degree ? std::max((*final_degree)[v], adj_extent[v].degree) : adj_extent[v].degree;
+            total_capacity += d + slack(d);
+        }
+
+        vector<int> new_slots(total_capacity);
+        unsigned long long pos = 0;
+        for (unsigned v=0; v<n; v++) {
+            auto & e = adj_extent[v];
+            int d = final_degree ? std::max((*final_degree)[v], e.degree) : e.degree;
+            int len = copy_live_entries(v, new_slots.data() + pos);
+            e = {pos, len, d + slack(d), len};
+            pos += e.capacity;
+        }
+        adj_slots.swap(new_slots);
+        num_abandoned_slots = 0;
+    }
+
+    // Make room for one more entry at the end of v's list
+    auto make_room_in_adj_list(int v) -> void
+    {
+        auto & e = adj_extent[v];
+        if (e.len > e.degree) {
+            compact_adj_list_in_place(v);
+        } else if (e.begin + e.capacity == adj_slots.size()) {
+            // the list is at the end of the array, so it can grow where it is
+            e.capacity = std::max(ADJ_LIST_MIN_CAPACITY, 2 * e.capacity);
+            adj_slots.resize(e.begin + e.capacity);
+        } else {
+            unsigned long long new_begin = adj_slots.size();
+            int new_capacity = std::max(ADJ_LIST_MIN_CAPACITY, 2 * e.capacity);
+            adj_slots.resize(new_begin + new_capacity);
+            std::copy(adj_slots.begin() + e.begin, adj_slots.begin() + e.begin + e.len,
+                    adj_slots.begin() + new_begin);
+            num_abandoned_slots += e.capacity;
+            e.begin = new_begin;
+            e.capacity = new_capacity;
+            if (num_abandoned_slots > adj_slots.size() / 2)
+                lay_out_adj_lists(nullptr);
+        }
+    }
+
+    auto append_to_adj_list(int v, int w) -> void
+    {
+        if (adj_extent[v].len == adj_extent[v].capacity)
+            make_room_in_adj_list(v);
+        auto & e = adj_extent[v];
+        adj_slots[e.begin + e.len++] = w;
+        ++e.degree;
+    }
+
+    auto remove_from_adj_list(int v, int w) -> void
+    {
+        auto & e = adj_extent[v];
+        int * first = adj_slots.data() + e.begin;
+        int * last = first + e.len;
+        *std::find(first, last, w) = ADJ_LIST_TOMBSTONE;
+        --e.degree;
+        while (e.len && first[e.len - 1] == ADJ_LIST_TOMBSTONE)
+            --e.len;
+        if (e.len - e.degree > e.degree)
+            compact_adj_list_in_place(v);
+    }
+
+public:
+    // Lay out the adjacency lists with room for degree[v] neighbours of each
+    // vertex v, so that adding the edges does not move any lists
+    auto reserve_adj_lists(const vector<int> & degree) -> void
     {
+        lay_out_adj_lists(&degree);
+    }
+
+    // Replace the adjacency lists with CSR arrays, in which the neighbours of
+    // v are neighbours[offsets[v]] to neighbours[offsets[v+1]-1]
+    auto assign_adj_lists(const uint64_t * offsets, const int32_t * neighbours) -> void
+    {
+        adj_slots.assign(neighbours, neighbours + offsets[n]);
+        for (unsigned v=0; v<n; v++) {
+            uint64_t d = offsets[v + 1] - offsets[v];
+            if (d > INT_MAX)
+                fail("An adjacency list is too long.");
+            adj_extent[v] = {offsets[v], int(d), int(d), int(d)};
+        }
+        num_abandoned_slots = 0;
+        if (has_edge_index)
+            build_edge_index();
+    }
+
+    auto index_vertex_if_hub(int v) -> void
+    {
+        if (!vertex_is_indexed[v] && degree(v) > EDGE_INDEX_MIN_DEGREE) {
+            vertex_is_indexed[v] = true;
+            for (int w : neighbours(v))
+                if (vertex_is_indexed[w])
+                    edge_index.insert(v, w);
+        }
+    }
+
+    auto edge_is_indexed(int v, int w) const -> bool
+    {
+        return has_edge_index && vertex_is_indexed[v] && vertex_is_indexed[w];
     }
 
     auto add_loop(int v) -> void
@@ -51,72 +330,111 @@ struct SparseGraph
 
     auto add_edge(int v, int w) -> void
     {
-        adjlist[v].push_back(w);
-        adjlist[w].push_back(v);
+        append_to_adj_list(v, w);
+        append_to_adj_list(w, v);
+        if (has_edge_index) {
+            if (edge_is_indexed(v, w))
+                edge_index.insert(v, w);
+            index_vertex_if_hub(v);
+            index_vertex_if_hub(w);
+        }
+    }
+
+    auto remove_edge(int v, int w) -> void
+    {
+        remove_from_adj_list(v, w);
+        remove_from_adj_list(w, v);
+        if (edge_is_indexed(v, w))
+            edge_index.erase(v, w);
+    }
+
+    // Remove all edges incident to v
+    auto isolate_vertex(int v) -> void
+    {
+        for (int w : neighbours(v)) {
+            remove_from_adj_list(w, v);
+            if (edge_is_indexed(v, w))
+                edge_index.erase(v, w);
+        }
+        adj_extent[v].len = 0;
+        adj_extent[v].degree = 0;
+    }
+
+    auto build_edge_index() -> void
+    {
+        has_edge_index = true;
+        vertex_is_indexed.assign(n, false);
+        edge_index.clear();
+        for (unsigned v=0; v<n; v++)
+            index_vertex_if_hub(v);
     }
 
     auto has_edge(int v, int w) const -> bool
     {
-        if (adjlist[w].size() < adjlist[v].size()) {
+        if (degree(w) < degree(v)) {
             // for speed, look in the smaller adjacency list
             std::swap(v, w);
         }
-        auto & v_adj_lst = adjlist[v];
-        return std::find(v_adj_lst.begin(), v_adj_lst.end(), w) != v_adj_lst.end();
+
+        // if v has a long list, both v and w are hubs
+        if (has_edge_index && degree(v) > EDGE_INDEX_MIN_DEGREE)
+            return edge_index.contains(v, w);
+
+        // a tombstone never matches w, so there is no need to skip them
+        auto & e = adj_extent[v];
+        const int * first = adj_slots.data() + e.begin;
+        return std::find(first, first + e.len, w) != first + e.len;
     }
 
-    auto vv_are_clique(const vector<int> & vv) const -> bool
+    auto vv_are_clique(const AdjList & vv) const -> bool
     {
-        for (unsigned i=0; i<vv.size(); i++) {
-            int v = vv[i];
-            auto & v_adj_lst = adjlist[v];
-            for (unsigned j=i+1; j<vv.size(); j++) {
-                int w = vv[j];
-                if (std::find(v_adj_lst.begin(), v_adj_lst.end(), w) == v_adj_lst.end()) {
+        for (auto it=vv.begin(); it!=vv.end(); ++it)
+            for (auto it2=std::next(it); it2!=vv.end(); ++it2)
+                if (!has_edge(*it, *it2))
                     return false;
-                }
-            }
-        }
         return true;
     }
 
     auto remove_edges_incident_to_loopy_vertices() -> void
     {
         for (unsigned i=0; i<n; i++) {
+            auto & e = adj_extent[i];
             if (vertex_has_loop[i]) {
-                adjlist[i].clear();
+                for (int w : neighbours(i))
+                    if (edge_is_indexed(i, w))
+                        edge_index.erase(i, w);
+                e.len = 0;
+                e.degree = 0;
             } else {
-                auto & lst = adjlist[i];
-                lst.erase(std::remove_if(
-                            lst.begin(),
-                            lst.end(),
-                            [this](int v){return vertex_has_loop[v];}),
-                        lst.end());
+                int * first = adj_slots.data() + e.begin;
+                e.len = std::remove_if(first, first + e.len,
+                            [this](int v){return v == ADJ_LIST_TOMBSTONE || vertex_has_loop[v];}) - first;
+                e.degree = e.len;
             }
         }
     }
 
     auto sort_adj_lists() -> void
     {
-        for (auto & list : adjlist)
-            std::sort(list.begin(), list.end());
+        for (unsigned v=0; v<n; v++) {
+            compact_adj_list_in_place(v);
+            auto & e = adj_extent[v];
+            std::sort(adj_slots.begin() + e.begin, adj_slots.begin() + e.begin + e.len);
+        }
     }
 
+    // Start with a complete graph, whose bit matrix is all zeros, and remove the
+    // edges of the induced subgraph.  This takes O(k^2/64 + m) time.
     auto complement_of_induced_subgraph(const vector<int> & vv) const -> Graph
     {
         vector<int> old_to_new_vtx(n, -1);
-        Graph subgraph(vv.size());
+        Graph subgraph = Graph::complete_graph(vv.size());
         for (unsigned i=0; i<vv.size(); i++)
             old_to_new_vtx[vv[i]] = i;
 
-        for (unsigned i=0; i<vv.size(); i++)
-            for (unsigned j=0; j<vv.size(); j++)
-                if (i != j)
-                    subgraph.add_edge(i, j);
-
         for (int old_v : vv) {
             int new_v = old_to_new_vtx[old_v];
-            for (int old_w : adjlist[old_v]) {
+            for (int old_w : neighbours(old_v)) {
                 if (old_w > old_v)
                     continue;
                 int new_w = old_to_new_vtx[old_w];
@@ -146,9 +464,10 @@ struct SparseGraph
         for (unsigned i=0; i<vv.size(); i++)
             old_to_new_vtx[vv[i]] = i;
 
+        reserve_subgraph_adj_lists(vv, old_to_new_vtx, subgraph);
         for (int old_v : vv) {
             int new_v = old_to_new_vtx[old_v];
-            for (int old_w : adjlist[old_v]) {
+            for (int old_w : neighbours(old_v)) {
                 if (old_w > old_v)
                     continue;
                 int new_w = old_to_new_vtx[old_w];
@@ -163,6 +482,24 @@ struct SparseGraph
             old_to_new_vtx[vv[i]] = -1;
     }
 
+    // Size the subgraph's adjacency lists before its edges are added.  Other
+    // graph types need no preparation.
+    template<typename T>
+    auto reserve_subgraph_adj_lists(const vector<int> &, const vector<int> &, T &) const -> void
+    {
+    }
+
+    auto reserve_subgraph_adj_lists(const vector<int> & vv, const vector<int> & old_to_new_vtx,
+            SparseGraph & subgraph) const -> void
+    {
+        vector<int> subgraph_degree(vv.size());
+        for (unsigned i=0; i<vv.size(); i++)
+            for (int old_w : neighbours(vv[i]))
+                if (old_to_new_vtx[old_w] != -1)
+                    ++subgraph_degree[i];
+        subgraph.reserve_adj_lists(subgraph_degree);
+    }
+
     template<typename T>
     auto induced_subgraph_reusing_graph(const vector<int> & vv, vector<int> & old_to_new_vtx,
             T & subgraph) const -> void
@@ -175,23 +512,23 @@ struct SparseGraph
     {
         n = new_n;
         weight.resize(n);
-        adjlist.resize(n);
-
-        for (auto & lst : adjlist)
-            lst.clear();
+        adj_extent.assign(n, {0, 0, 0, 0});
+        adj_slots.clear();
+        num_abandoned_slots = 0;
+        if (has_edge_index) {
+            vertex_is_indexed.assign(n, false);
+            edge_index.clear();
+        }
     }
 
     auto print_dimacs_format() -> void
     {
-        long endpoint_count = 0;
-        for (auto & lst : adjlist)
-            endpoint_count += lst.size();
-        std::cout << "p edge " << n << " " << (endpoint_count/2) << std::endl;
+        std::cout << "p edge " << n << " " << num_edges() << std::endl;
         for (unsigned i=0; i<n; i++) {
             std::cout << "n " << (i+1) << " " << weight[i] << std::endl;
         }
         for (unsigned i=0; i<n; i++) {
-            for (unsigned j : adjlist[i]) {
+            for (unsigned j : neighbours(i)) {
                 if (j > i)
                     break;
                 std::cout << "e " << (i+1) << " " << (j+1) << std::endl;
@@ -200,10 +537,13 @@ struct SparseGraph
     }
 };
 
-SparseGraph readSparseGraph();
+// Read a graph from standard input, parsing and de-duplicating the edges on up
+// to num_threads threads
+SparseGraph readSparseGraph(int num_threads);
 
-SparseGraph readSparseGraphPaceFormat();
+SparseGraph readSparseGraphPaceFormat(int num_threads);
 
-SparseGraph fastReadSparseGraphPaceFormat();
+// Read a graph from a binary CSR snapshot (see csr_snapshot.h) on standard input
+SparseGraph readSparseGraphCsrSnapshot();
 
 #endif
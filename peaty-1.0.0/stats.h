@@ -0,0 +1,25 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <chrono>
+
+using Duration = std::chrono::steady_clock::duration;
+
+// What the solution of one component cost, and what ended its search.  The
+// times spent colouring and in unit propagation are only recorded if
+// params.collect_stats is set, because they are measured at every node.
+struct ComponentStats
+{
+    unsigned size = 0;
+    long num_edges = 0;
+    long search_node_count = 0;
+    Duration time {};
+    Duration colouring_time {};
+    Duration unit_propagation_time {};
+    Duration local_search_time {};
+    Duration colouring_number_time {};
+    const char * closed_by = "search";
+    long peak_rss_kb = 0;    // of the whole process, when the component was finished
+};
+
+#endif
@@ -1,9 +1,18 @@
+#include "util.h"
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/resource.h>
+
+std::atomic<bool> aborted(false);
 
 void fail(const char* msg) {
     fprintf(stderr, "%s\n", msg);
     exit(1);
 }
 
-
+long peak_rss_kb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
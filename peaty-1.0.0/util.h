@@ -1,7 +1,16 @@
 #ifndef UTIL_H
 #define UTIL_H
 
+#include <atomic>
+
 void fail(const char* msg);
 
-#endif
+// The peak resident set size of the process so far, in kilobytes
+long peak_rss_kb();
 
+// Set when the time limit passes or the process is sent SIGTERM.  The
+// searches poll it and return early, keeping the best solutions they have
+// found so far.
+extern std::atomic<bool> aborted;
+
+#endif